@@ -0,0 +1,205 @@
+#ifndef _BENCH_H
+#define _BENCH_H
+
+/*
+ * Helpers shared by the benchmarks
+ *
+ * A benchmark runs a number of rounds of operations, timing them one by one,
+ * or in small batches of BENCH_BATCH when a single one is too short to time.
+ * It reports the distribution of the per-operation cost over all the samples
+ * as one line of JSON on stdout, e.g.:
+ *
+ * {"benchmark":"yield_pingpong","unit":"ns/switch","samples":31250,"median":95.1,
+ *  "p99":130.2,...}
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <time.h>
+
+/* Default number of rounds of a benchmark */
+#define BENCH_ROUNDS 50
+
+/* Number of operations timed together when timing them one by one is too fine */
+#define BENCH_BATCH 16
+
+/* Monotonic time in nanoseconds */
+static inline double bench_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static inline int bench_cmp(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+/* Value below which @pct percent of the sorted @samples fall */
+static inline double bench_percentile(const double *samples, size_t n,
+				      double pct)
+{
+	size_t idx = (size_t)(pct / 100.0 * (n - 1) + 0.5);
+
+	return samples[idx];
+}
+
+/*
+ * Cost of a call to bench_now_ns(), subtracted from the latency of single
+ * operations: the smallest difference between two consecutive calls
+ */
+static inline double bench_timer_overhead(void)
+{
+	double best = 1e9;
+	int i;
+
+	for (i = 0; i < 1000; i++) {
+		double start = bench_now_ns(), d = bench_now_ns() - start;
+
+		if (d < best)
+			best = d;
+	}
+	return best;
+}
+
+/*
+ * bench_report_latency - Print the percentiles of single operation latencies
+ * @name: Name of the benchmark
+ * @unit: Unit of the latencies
+ * @latencies: Latency of every operation (sorted in place)
+ * @n: Number of operations
+ */
+static inline void bench_report_latency(const char *name, const char *unit,
+					double *latencies, size_t n)
+{
+	qsort(latencies, n, sizeof(*latencies), bench_cmp);
+	printf("{\"benchmark\":\"%s\",\"unit\":\"%s\",\"samples\":%zu,"
+	       "\"min\":%.2f,\"median\":%.2f,\"p90\":%.2f,\"p99\":%.2f,"
+	       "\"p999\":%.2f,\"max\":%.2f}\n",
+	       name, unit, n, latencies[0],
+	       bench_percentile(latencies, n, 50),
+	       bench_percentile(latencies, n, 90),
+	       bench_percentile(latencies, n, 99),
+	       bench_percentile(latencies, n, 99.9), latencies[n - 1]);
+	fflush(stdout);
+}
+
+/* Samples of the per-operation cost of a benchmark */
+struct bench_samples {
+	double *v;		/* Samples taken */
+	size_t n;		/* Number of samples taken */
+	size_t cap;		/* Capacity of @v, further samples are dropped */
+	double overhead;	/* Cost of reading the clock */
+};
+
+/* Allocate room for @cap samples, and measure the cost of reading the clock */
+static inline void bench_samples_init(struct bench_samples *s, size_t cap)
+{
+	s->v = malloc((cap ? cap : 1) * sizeof(*s->v));
+	if (!s->v) {
+		fprintf(stderr, "Cannot allocate %zu samples\n", cap);
+		exit(1);
+	}
+	s->n = 0;
+	s->cap = cap;
+	s->overhead = bench_timer_overhead();
+}
+
+/*
+ * bench_sample - Record the cost of @ops operations started at @start
+ *
+ * Return: The current time, at which the next operations can be taken to start
+ */
+static inline double bench_sample(struct bench_samples *s, double start,
+				  double ops)
+{
+	double now = bench_now_ns();
+
+	if (s->n < s->cap)
+		s->v[s->n++] = (now - start - s->overhead) / ops;
+	return now;
+}
+
+/* Report the samples taken with bench_report_latency(), and forget them */
+static inline void bench_samples_report(struct bench_samples *s,
+					const char *name, const char *unit)
+{
+	if (s->n)
+		bench_report_latency(name, unit, s->v, s->n);
+	s->n = 0;
+}
+
+static inline void bench_samples_free(struct bench_samples *s)
+{
+	free(s->v);
+	s->v = NULL;
+}
+
+/*
+ * bench_report_requests - Print the throughput and latency of requests
+ * @name: Name of the benchmark
+ * @latencies: Latency of every request, in nanoseconds (sorted in place)
+ * @n: Number of requests
+ * @elapsed: Time taken to serve all the requests, in nanoseconds
+ */
+static inline void bench_report_requests(const char *name, double *latencies,
+					 size_t n, double elapsed)
+{
+	if (n == 0) {
+		printf("{\"benchmark\":\"%s\",\"requests\":0}\n", name);
+		fflush(stdout);
+		return;
+	}
+
+	qsort(latencies, n, sizeof(*latencies), bench_cmp);
+	printf("{\"benchmark\":\"%s\",\"requests\":%zu,\"req_per_s\":%.0f,"
+	       "\"unit\":\"us\",\"p50\":%.2f,\"p90\":%.2f,\"p99\":%.2f,"
+	       "\"p999\":%.2f,\"max\":%.2f}\n",
+	       name, n, n / (elapsed / 1e9),
+	       bench_percentile(latencies, n, 50) / 1e3,
+	       bench_percentile(latencies, n, 90) / 1e3,
+	       bench_percentile(latencies, n, 99) / 1e3,
+	       bench_percentile(latencies, n, 99.9) / 1e3,
+	       latencies[n - 1] / 1e3);
+	fflush(stdout);
+}
+
+/* Raise the limit of open files to fit @nfiles, return -1 if impossible */
+static inline int bench_nofile(rlim_t nfiles)
+{
+	struct rlimit rl;
+
+	if (getrlimit(RLIMIT_NOFILE, &rl) == -1)
+		return -1;
+	if (rl.rlim_cur >= nfiles)
+		return 0;
+	if (rl.rlim_max < nfiles)
+		return -1;
+	rl.rlim_cur = nfiles;
+	return setrlimit(RLIMIT_NOFILE, &rl);
+}
+
+/* Number of operations per round, optionally overridden by @argv */
+static inline unsigned int bench_ops(int argc, char **argv,
+				     unsigned int def)
+{
+	long int ret;
+
+	if (argc < 2)
+		return def;
+
+	ret = strtol(argv[1], NULL, 0);
+	if (ret <= 0 || ret == LONG_MAX) {
+		fprintf(stderr, "Invalid number of operations: %s\n", argv[1]);
+		exit(1);
+	}
+	return ret;
+}
+
+#endif /* _BENCH_H */
@@ -0,0 +1,88 @@
+/*
+ * Per-thread arena allocator benchmark
+ *
+ * Threads make a batch of small allocations each, which all die when they exit,
+ * either with malloc(), freeing them before exiting, or from their arena with
+ * uthread_arena_alloc(). Every thread is timed from its creation to its exit,
+ * and the cost of one allocation is reported in each case, thread creation and
+ * exit included.
+ */
+
+#include <stdlib.h>
+
+#include <alloc.h>
+#include <uthread.h>
+
+#include "bench.h"
+
+#define ALLOC_SIZE 64
+
+/* Allocations made by a thread */
+#define NALLOCS 256
+
+static unsigned int nops;
+static void *ptrs[NALLOCS];
+static struct bench_samples malloc_samples;
+static struct bench_samples arena_samples;
+
+static void with_malloc(void *arg)
+{
+	unsigned int i;
+	(void)arg;
+
+	for (i = 0; i < NALLOCS; i++) {
+		ptrs[i] = malloc(ALLOC_SIZE);
+		*(char *)ptrs[i] = 0;
+	}
+	for (i = 0; i < NALLOCS; i++)
+		free(ptrs[i]);
+}
+
+static void with_arena(void *arg)
+{
+	unsigned int i;
+	(void)arg;
+
+	for (i = 0; i < NALLOCS; i++) {
+		ptrs[i] = uthread_arena_alloc(ALLOC_SIZE);
+		*(char *)ptrs[i] = 0;
+	}
+}
+
+static void driver(void *arg)
+{
+	unsigned int r, i;
+	(void)arg;
+
+	for (r = 0; r < BENCH_ROUNDS; r++) {
+		for (i = 0; i < nops; i += NALLOCS) {
+			double start = bench_now_ns();
+
+			uthread_create(with_malloc, NULL);
+			uthread_yield();
+			start = bench_sample(&malloc_samples, start, NALLOCS);
+
+			uthread_create(with_arena, NULL);
+			uthread_yield();
+			bench_sample(&arena_samples, start, NALLOCS);
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	size_t nthreads;
+
+	nops = bench_ops(argc, argv, 10000);
+	nthreads = (size_t)BENCH_ROUNDS * ((nops + NALLOCS - 1) / NALLOCS);
+	bench_samples_init(&malloc_samples, nthreads);
+	bench_samples_init(&arena_samples, nthreads);
+
+	uthread_run(false, driver, NULL);
+	bench_samples_report(&malloc_samples, "alloc_malloc", "ns/alloc");
+	bench_samples_report(&arena_samples, "alloc_arena", "ns/alloc");
+
+	bench_samples_free(&malloc_samples);
+	bench_samples_free(&arena_samples);
+	return 0;
+}
@@ -0,0 +1,116 @@
+/*
+ * Fork-join benchmark
+ *
+ * A group of workers goes through many phases, which are separated either by
+ * semaphores (the last worker to arrive releases the others one by one) or by
+ * a barrier (which releases all of them at once). The last worker to arrive
+ * times every phase, and the cost of a phase per worker is reported.
+ */
+
+#include <stdbool.h>
+
+#include <barrier.h>
+#include <sem.h>
+#include <uthread.h>
+
+#include "bench.h"
+
+#define NWORKERS 64
+
+static unsigned int nops;
+static bool use_barrier;
+static uthread_barrier_t barrier;
+static sem_t mutex, gate;
+static unsigned int arrived;
+static double last;		/* End of the previous phase, 0 before the first */
+static struct bench_samples barrier_samples;
+static struct bench_samples sem_samples;
+
+/*
+ * Semaphore-based barrier, releasing the waiters with one sem_up() each.
+ * Returns 1 for the last thread to arrive, like uthread_barrier_wait().
+ */
+static int sem_barrier_wait(void)
+{
+	int i;
+
+	sem_down(mutex);
+	if (++arrived == NWORKERS) {
+		arrived = 0;
+		sem_up(mutex);
+		for (i = 0; i < NWORKERS - 1; i++)
+			sem_up(gate);
+		return 1;
+	}
+	sem_up(mutex);
+	sem_down(gate);
+	return 0;
+}
+
+static void worker(void *arg)
+{
+	unsigned int i;
+	(void)arg;
+
+	for (i = 0; i < nops; i++) {
+		struct bench_samples *s;
+
+		if (use_barrier) {
+			if (uthread_barrier_wait(barrier) != 1)
+				continue;
+			s = &barrier_samples;
+		} else {
+			if (sem_barrier_wait() != 1)
+				continue;
+			s = &sem_samples;
+		}
+
+		/* The first phase also times the creation of the workers */
+		if (last)
+			last = bench_sample(s, last, NWORKERS);
+		else
+			last = bench_now_ns();
+	}
+}
+
+static void driver(void *arg)
+{
+	int i;
+	(void)arg;
+
+	for (i = 0; i < NWORKERS; i++)
+		uthread_create(worker, NULL);
+}
+
+static void run(bool with_barrier)
+{
+	use_barrier = with_barrier;
+	last = 0;
+	uthread_run(false, driver, NULL);
+}
+
+int main(int argc, char **argv)
+{
+	int r;
+
+	nops = bench_ops(argc, argv, 100);
+	bench_samples_init(&sem_samples, (size_t)BENCH_ROUNDS * nops);
+	bench_samples_init(&barrier_samples, (size_t)BENCH_ROUNDS * nops);
+	barrier = uthread_barrier_create(NWORKERS);
+	mutex = sem_create(1);
+	gate = sem_create(0);
+
+	for (r = 0; r < BENCH_ROUNDS; r++) {
+		run(false);
+		run(true);
+	}
+	bench_samples_report(&sem_samples, "join_sem", "ns/worker");
+	bench_samples_report(&barrier_samples, "join_barrier", "ns/worker");
+
+	bench_samples_free(&sem_samples);
+	bench_samples_free(&barrier_samples);
+	uthread_barrier_destroy(barrier);
+	sem_destroy(mutex);
+	sem_destroy(gate);
+	return 0;
+}
@@ -0,0 +1,53 @@
+/*
+ * Thread creation benchmark
+ *
+ * A thread creates batches of threads which exit immediately, and waits for
+ * all of them to have run. Reports the cost of one uthread_create() and
+ * uthread_exit() pair.
+ */
+
+#include <uthread.h>
+
+#include "bench.h"
+
+static unsigned int nops;
+static unsigned int exited;
+static struct bench_samples samples;
+
+static void child(void *arg)
+{
+	(void)arg;
+
+	exited++;
+}
+
+static void driver(void *arg)
+{
+	unsigned int r, i, b;
+	double start;
+	(void)arg;
+
+	for (r = 0; r < BENCH_ROUNDS; r++) {
+		start = bench_now_ns();
+		for (b = 0; b < nops; b += BENCH_BATCH) {
+			exited = 0;
+			for (i = 0; i < BENCH_BATCH; i++)
+				uthread_create(child, NULL);
+			while (exited < BENCH_BATCH)
+				uthread_yield();
+			start = bench_sample(&samples, start, BENCH_BATCH);
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	nops = bench_ops(argc, argv, 1000);
+	bench_samples_init(&samples, (size_t)BENCH_ROUNDS *
+			   ((nops + BENCH_BATCH - 1) / BENCH_BATCH));
+	uthread_run(false, driver, NULL);
+	bench_samples_report(&samples, "create_exit", "ns/thread");
+	bench_samples_free(&samples);
+
+	return 0;
+}
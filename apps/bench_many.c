@@ -0,0 +1,106 @@
+/*
+ * Many threads switch benchmark
+ *
+ * A large number of threads (one million by default) yield in turn, so that
+ * every switch goes to a stack which was not touched for a long time. Stacks
+ * are either allocated with malloc(), or packed in a stack arena. Every switch
+ * is timed, from the yield of a thread to the return from the yield of the
+ * next one. Reports the cost of a context switch, along with the number of
+ * threads.
+ *
+ * Since malloc()'d stacks take 32 KiB each, the comparison with the arena is
+ * made on an eighth of the threads, and only the arena runs the full count.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include <stack.h>
+#include <uthread.h>
+
+#include "bench.h"
+
+#define ROUNDS 10
+
+/* Largest number of switches timed in a run, the others being dropped */
+#define MAX_SAMPLES (1U << 22)
+
+/* Arena slot size, enough for threads that only yield */
+#define SLOT_SIZE 2048
+
+static unsigned int nthreads;
+static bool stop;
+static bool timing;
+static double last;		/* Time of the latest yield */
+static struct bench_samples samples;
+
+/* Time the switch that led to the caller, and the next one from now on */
+static void timed_yield(void)
+{
+	if (timing)
+		bench_sample(&samples, last, 1);
+	last = bench_now_ns();
+	uthread_yield();
+}
+
+static void spinner(void *arg)
+{
+	(void)arg;
+
+	while (!stop)
+		timed_yield();
+}
+
+static void driver(void *arg)
+{
+	unsigned int i;
+	int r;
+	(void)arg;
+
+	stop = false;
+	for (i = 0; i < nthreads; i++)
+		if (uthread_create(spinner, NULL) == -1)
+			break;
+
+	/* Let every thread run once, so that their stacks are faulted in */
+	timing = false;
+	uthread_yield();
+
+	timing = true;
+	for (r = 0; r < ROUNDS; r++)
+		timed_yield();
+	timing = false;
+	stop = true;
+}
+
+static void run(unsigned int n, bool arena)
+{
+	char name[64];
+
+	if (arena && uthread_stack_arena(n + 1, SLOT_SIZE, false) == -1) {
+		fprintf(stderr, "Cannot set up an arena of %u stacks\n", n + 1);
+		return;
+	}
+
+	nthreads = n;
+	uthread_run(false, driver, NULL);
+	uthread_stack_arena(0, 0, false);
+
+	snprintf(name, sizeof(name), "switch_%s_%u", arena ? "arena" : "malloc",
+		 n);
+	bench_samples_report(&samples, name, "ns/switch");
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int n = bench_ops(argc, argv, 1000000);
+	size_t cap = (size_t)ROUNDS * (n + 1);
+
+	bench_samples_init(&samples, cap < MAX_SAMPLES ? cap : MAX_SAMPLES);
+	run(n / 8, false);
+	run(n / 8, true);
+	run(n, true);
+
+	bench_samples_free(&samples);
+	return 0;
+}
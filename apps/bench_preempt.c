@@ -0,0 +1,108 @@
+/*
+ * Preemption overhead benchmark
+ *
+ * A fixed amount of CPU-bound work is split among several threads which never
+ * yield, and is run alternately without and with preemption. The work of each
+ * thread is timed in chunks, whose cost per iteration is reported for both
+ * runs, preemptions showing in the tail of the preemptive one. Also reports how
+ * much longer each preemptive run takes than the cooperative run just before
+ * it, in percent, whose median over the rounds is the overhead of preemption.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <uthread.h>
+
+#include "bench.h"
+
+#define NTHREADS 4
+#define ROUNDS 50
+
+/* Iterations timed together */
+#define CHUNK 10000
+
+static unsigned int nops;
+static struct bench_samples samples[NTHREADS];
+
+static void worker(void *arg)
+{
+	struct bench_samples *s = arg;
+	volatile unsigned long x = 0;
+	unsigned int i, j;
+	double start = bench_now_ns();
+
+	for (i = 0; i < nops; i += CHUNK) {
+		for (j = i; j < i + CHUNK; j++)
+			x += j * j;
+		start = bench_sample(s, start, CHUNK);
+	}
+}
+
+static void driver(void *arg)
+{
+	int i;
+	(void)arg;
+
+	for (i = 0; i < NTHREADS; i++)
+		uthread_create(worker, &samples[i]);
+}
+
+static double run(bool preempt)
+{
+	double start = bench_now_ns();
+
+	uthread_run(preempt, driver, NULL);
+	return bench_now_ns() - start;
+}
+
+/* Move the samples of the threads over to @all */
+static void collect(struct bench_samples *all)
+{
+	int i;
+
+	for (i = 0; i < NTHREADS; i++) {
+		memcpy(all->v + all->n, samples[i].v,
+		       samples[i].n * sizeof(*all->v));
+		all->n += samples[i].n;
+		samples[i].n = 0;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	struct bench_samples off, on;
+	double pairs[ROUNDS];
+	size_t per_run;
+	int r, i;
+
+	nops = bench_ops(argc, argv, 10000000);
+	nops = (nops + CHUNK - 1) / CHUNK * CHUNK;
+	per_run = nops / CHUNK;
+
+	for (i = 0; i < NTHREADS; i++)
+		bench_samples_init(&samples[i], per_run);
+	bench_samples_init(&off, (size_t)ROUNDS * NTHREADS * per_run);
+	bench_samples_init(&on, (size_t)ROUNDS * NTHREADS * per_run);
+
+	/* Alternate the runs, so that both suffer from the same disturbances */
+	for (r = 0; r < ROUNDS; r++) {
+		double a = run(false), b;
+
+		collect(&off);
+		b = run(true);
+		collect(&on);
+		pairs[r] = (b - a) * 100.0 / a;
+	}
+
+	bench_samples_report(&off, "cpu_bound_cooperative", "ns/iteration");
+	bench_samples_report(&on, "cpu_bound_preemptive", "ns/iteration");
+	bench_report_latency("preempt_overhead", "percent", pairs, ROUNDS);
+
+	for (i = 0; i < NTHREADS; i++)
+		bench_samples_free(&samples[i]);
+	bench_samples_free(&off);
+	bench_samples_free(&on);
+	return 0;
+}
@@ -0,0 +1,44 @@
+/*
+ * Queue benchmark
+ *
+ * Keeps a queue filled with a number of items, moving batches of items through
+ * it: each batch is enqueued at the tail while as many items are dequeued at
+ * the head. Reports the cost of one queue_enqueue() plus one queue_dequeue().
+ */
+
+#include <queue.h>
+
+#include "bench.h"
+
+int main(int argc, char **argv)
+{
+	unsigned int nops = bench_ops(argc, argv, 100000);
+	unsigned int r, b, i;
+	queue_t q = queue_create();
+	struct bench_samples samples;
+	double start;
+	void *data;
+
+	bench_samples_init(&samples, (size_t)BENCH_ROUNDS *
+			   ((nops + BENCH_BATCH - 1) / BENCH_BATCH));
+	for (i = 0; i < nops; i++)
+		queue_enqueue(q, &samples);
+
+	for (r = 0; r < BENCH_ROUNDS; r++) {
+		start = bench_now_ns();
+		for (b = 0; b < nops; b += BENCH_BATCH) {
+			for (i = 0; i < BENCH_BATCH; i++)
+				queue_enqueue(q, &samples);
+			for (i = 0; i < BENCH_BATCH; i++)
+				queue_dequeue(q, &data);
+			start = bench_sample(&samples, start, BENCH_BATCH);
+		}
+	}
+	while (queue_dequeue(q, &data) == 0)
+		;
+	queue_destroy(q);
+	bench_samples_report(&samples, "queue_enqueue_dequeue", "ns/item");
+	bench_samples_free(&samples);
+
+	return 0;
+}
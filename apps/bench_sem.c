@@ -0,0 +1,212 @@
+/*
+ * Semaphore benchmarks
+ *
+ * - sem_handoff: two threads wake each other up through a pair of semaphores.
+ *   Reports the cost of handing control over with sem_up() + sem_down().
+ * - sem_roundtrip: same, timing every round trip (two handoffs) on its own
+ *   rather than in batches.
+ * - producer_consumer: a producer and a consumer exchange items through a
+ *   bounded buffer guarded by counting semaphores, as in sem_buffer.c. Reports
+ *   the cost of moving one item through the buffer.
+ * - release_loop / release_batch: a thread releases one resource to each of a
+ *   group of waiting threads, either with one sem_up() per resource or with a
+ *   single sem_up_n(). Reports the cost of waking up one waiter.
+ * - busy_handoff_rr / busy_handoff_runnext: same as sem_handoff, while other
+ *   threads keep yielding, with the default policy and with the run next slot.
+ */
+
+#include <stdbool.h>
+
+#include <sem.h>
+#include <uthread.h>
+#include <uthread_sched.h>
+
+#include "bench.h"
+
+#define BUFFER_SIZE 16
+#define NWAITERS 64
+#define NBYSTANDERS 16
+
+static unsigned int nops;
+static struct bench_samples samples;
+
+/* Number of batches of BENCH_BATCH operations */
+static unsigned int nbatches;
+
+static sem_t ping, pong;
+
+static void ponger(void *arg)
+{
+	unsigned int n = *(unsigned int *)arg;
+
+	while (n--) {
+		sem_down(ping);
+		sem_up(pong);
+	}
+}
+
+static unsigned int nbystanders;
+static bool handoff_done;
+
+static void bystander(void *arg)
+{
+	(void)arg;
+
+	while (!handoff_done)
+		uthread_yield();
+}
+
+static void handoff(void *arg)
+{
+	unsigned int b, i, total = nbatches * BENCH_BATCH;
+	double start;
+	(void)arg;
+
+	handoff_done = false;
+	for (i = 0; i < nbystanders; i++)
+		uthread_create(bystander, NULL);
+	uthread_create(ponger, &total);
+
+	start = bench_now_ns();
+	for (b = 0; b < nbatches; b++) {
+		for (i = 0; i < BENCH_BATCH; i++) {
+			sem_up(ping);
+			sem_down(pong);
+		}
+		start = bench_sample(&samples, start, 2.0 * BENCH_BATCH);
+	}
+	handoff_done = true;
+}
+
+static void handoff_latency(void *arg)
+{
+	unsigned int i, total = nbatches * BENCH_BATCH;
+	(void)arg;
+
+	uthread_create(ponger, &total);
+	for (i = 0; i < total; i++) {
+		double start = bench_now_ns();
+
+		sem_up(ping);
+		sem_down(pong);
+		bench_sample(&samples, start, 1);
+	}
+}
+
+static sem_t empty, full;
+static unsigned int buffer[BUFFER_SIZE];
+
+static void consumer(void *arg)
+{
+	unsigned int n = *(unsigned int *)arg, tail = 0;
+	volatile unsigned int sink;
+
+	while (n--) {
+		sem_down(full);
+		sink = buffer[tail];
+		tail = (tail + 1) % BUFFER_SIZE;
+		sem_up(empty);
+	}
+	(void)sink;
+}
+
+static void producer(void *arg)
+{
+	unsigned int b, i, head = 0, total = nbatches * BENCH_BATCH;
+	double start;
+	(void)arg;
+
+	uthread_create(consumer, &total);
+	start = bench_now_ns();
+	for (b = 0; b < nbatches; b++) {
+		for (i = 0; i < BENCH_BATCH; i++) {
+			sem_down(empty);
+			buffer[head] = i;
+			head = (head + 1) % BUFFER_SIZE;
+			sem_up(full);
+		}
+		start = bench_sample(&samples, start, BENCH_BATCH);
+	}
+}
+
+static sem_t work;
+static bool batch;
+
+static void waiter(void *arg)
+{
+	unsigned int n = *(unsigned int *)arg;
+
+	while (n--)
+		sem_down(work);
+}
+
+static void releaser(void *arg)
+{
+	unsigned int r, i, w, total = BENCH_ROUNDS * nops;
+	(void)arg;
+
+	for (w = 0; w < NWAITERS; w++)
+		uthread_create(waiter, &total);
+	uthread_yield();
+
+	/* Each operation wakes up all the waiters, and is timed on its own */
+	for (r = 0; r < BENCH_ROUNDS; r++) {
+		for (i = 0; i < nops; i++) {
+			double start = bench_now_ns();
+
+			if (batch) {
+				sem_up_n(work, NWAITERS);
+			} else {
+				for (w = 0; w < NWAITERS; w++)
+					sem_up(work);
+			}
+			/* Let all the waiters run and block again */
+			uthread_yield();
+			bench_sample(&samples, start, NWAITERS);
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	nops = bench_ops(argc, argv, 10000);
+	nbatches = (BENCH_ROUNDS * nops + BENCH_BATCH - 1) / BENCH_BATCH;
+	bench_samples_init(&samples, (size_t)nbatches * BENCH_BATCH);
+
+	ping = sem_create(0);
+	pong = sem_create(0);
+	uthread_run(false, handoff, NULL);
+	bench_samples_report(&samples, "sem_handoff", "ns/handoff");
+	uthread_run(false, handoff_latency, NULL);
+	bench_samples_report(&samples, "sem_roundtrip", "ns/roundtrip");
+
+	nbystanders = NBYSTANDERS;
+	uthread_run(false, handoff, NULL);
+	bench_samples_report(&samples, "busy_handoff_rr", "ns/handoff");
+	uthread_run_policy(false, &uthread_sched_runnext, handoff, NULL);
+	bench_samples_report(&samples, "busy_handoff_runnext", "ns/handoff");
+	sem_destroy(ping);
+	sem_destroy(pong);
+
+	empty = sem_create(BUFFER_SIZE);
+	full = sem_create(0);
+	uthread_run(false, producer, NULL);
+	bench_samples_report(&samples, "producer_consumer", "ns/item");
+	sem_destroy(empty);
+	sem_destroy(full);
+
+	/* Each operation wakes up all the waiters */
+	nops = nops > NWAITERS ? nops / NWAITERS : 1;
+	work = sem_create(0);
+	batch = false;
+	uthread_run(false, releaser, NULL);
+	bench_samples_report(&samples, "release_loop", "ns/wakeup");
+	batch = true;
+	uthread_run(false, releaser, NULL);
+	bench_samples_report(&samples, "release_batch", "ns/wakeup");
+	sem_destroy(work);
+
+	bench_samples_free(&samples);
+
+	return 0;
+}
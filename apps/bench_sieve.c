@@ -0,0 +1,207 @@
+/*
+ * Parallel prime sieve benchmark
+ *
+ * Counts the primes below a limit with a segmented sieve of Eratosthenes,
+ * rather than with one filter thread per prime as sem_prime does. The segments
+ * are processed in a single thread, by uthread_parallel_for(), and by a fixed
+ * number of workers forked and joined with uthread_spawn() and uthread_sync().
+ * Every segment is timed from the end of the one sieved before it, so that the
+ * time spent scheduling between segments is accounted for. Reports the cost of
+ * one number in each case, the worker runs showing how the sieve scales with
+ * the number of workers.
+ *
+ * The library runs every thread on a single executor, so more workers can only
+ * add overhead there: the worker runs measure that overhead.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <parallel.h>
+#include <uthread.h>
+
+#include "bench.h"
+
+/* Numbers sieved by a segment */
+#define GRAIN 32768
+
+/* Largest number of workers, doubling from 1 */
+#define MAX_WORKERS 8
+#define NR_WORKER_RUNS 4
+
+static unsigned int limit;
+static unsigned int *base;		/* Primes up to the square root of @limit */
+static size_t nbase;
+static unsigned char *composite;
+static size_t count;
+static size_t expected;
+
+static struct bench_samples seq_samples;
+static struct bench_samples pfor_samples;
+static struct bench_samples worker_samples[NR_WORKER_RUNS];
+
+/* Samples of the current run, NULL when not timing */
+static struct bench_samples *samples;
+static double last;		/* End of the latest segment */
+
+static void sieve_base(void)
+{
+	unsigned int root = 1, i, j;
+	unsigned char *small;
+
+	while ((root + 1) * (root + 1) <= limit)
+		root++;
+
+	small = calloc(root + 1, 1);
+	base = malloc((root + 1) * sizeof(*base));
+	for (i = 2; i <= root; i++) {
+		if (small[i])
+			continue;
+		base[nbase++] = i;
+		for (j = i * i; j <= root; j += i)
+			small[j] = 1;
+	}
+	free(small);
+}
+
+/* Sieve the numbers in [@begin, @end) and count the primes among them */
+static void sieve_range(size_t begin, size_t end, void *arg)
+{
+	size_t i, n = 0;
+	(void)arg;
+
+	for (i = 0; i < nbase; i++) {
+		size_t p = base[i];
+		size_t j = (begin + p - 1) / p * p;
+
+		if (p * p >= end)
+			break;
+		if (j < p * p)
+			j = p * p;
+		for (; j < end; j += p)
+			composite[j] = 1;
+	}
+
+	for (i = begin < 2 ? 2 : begin; i < end; i++)
+		n += !composite[i];
+	count += n;
+
+	if (samples)
+		last = bench_sample(samples, last, end - begin);
+}
+
+struct worker {
+	size_t begin, end;
+};
+
+/* Static share of the range of a worker, sieved one segment at a time */
+static void worker(void *arg)
+{
+	struct worker *w = arg;
+	size_t b;
+
+	for (b = w->begin; b < w->end; b += GRAIN)
+		sieve_range(b, b + GRAIN < w->end ? b + GRAIN : w->end, NULL);
+}
+
+static void sieve_workers(unsigned int nworkers)
+{
+	struct uthread_group group = UTHREAD_GROUP_INIT;
+	struct worker workers[MAX_WORKERS];
+	size_t share = (limit + nworkers - 1) / nworkers;
+	unsigned int i;
+
+	for (i = 0; i < nworkers; i++) {
+		workers[i].begin = i * share;
+		workers[i].end = (i + 1) * share < limit ? (i + 1) * share : limit;
+		uthread_spawn(&group, worker, &workers[i]);
+	}
+	uthread_sync(&group);
+}
+
+/* Time the segments sieved from now on into @s */
+static void start_timing(struct bench_samples *s)
+{
+	samples = s;
+	last = bench_now_ns();
+}
+
+static void check(void)
+{
+	if (count != expected) {
+		fprintf(stderr, "Wrong number of primes: %zu, expected %zu\n",
+			count, expected);
+		exit(1);
+	}
+	count = 0;
+	memset(composite, 0, limit);
+}
+
+static void driver(void *arg)
+{
+	struct worker all = { 0, limit };
+	unsigned int r, w;
+	(void)arg;
+
+	/* Reference count, which also warms the array up */
+	worker(&all);
+	expected = count;
+	count = 0;
+	memset(composite, 0, limit);
+
+	for (r = 0; r < BENCH_ROUNDS; r++) {
+		start_timing(&seq_samples);
+		worker(&all);
+		check();
+
+		start_timing(&pfor_samples);
+		uthread_parallel_for(0, limit, GRAIN, sieve_range, NULL);
+		check();
+
+		for (w = 0; w < NR_WORKER_RUNS; w++) {
+			start_timing(&worker_samples[w]);
+			sieve_workers(1U << w);
+			check();
+		}
+	}
+	samples = NULL;
+}
+
+int main(int argc, char **argv)
+{
+	char name[32];
+	unsigned int w;
+	size_t nsegments;
+
+	limit = bench_ops(argc, argv, 1 << 22);
+	composite = calloc(limit, 1);
+	sieve_base();
+
+	/*
+	 * uthread_parallel_for() may halve ranges down to just over half of a
+	 * segment, and workers cut one short at the end of their share
+	 */
+	nsegments = (size_t)BENCH_ROUNDS * (2 * ((limit + GRAIN - 1) / GRAIN) +
+					    MAX_WORKERS);
+	bench_samples_init(&seq_samples, nsegments);
+	bench_samples_init(&pfor_samples, nsegments);
+	for (w = 0; w < NR_WORKER_RUNS; w++)
+		bench_samples_init(&worker_samples[w], nsegments);
+
+	uthread_run(false, driver, NULL);
+	bench_samples_report(&seq_samples, "sieve_sequential", "ns/number");
+	bench_samples_report(&pfor_samples, "sieve_parallel_for", "ns/number");
+	for (w = 0; w < NR_WORKER_RUNS; w++) {
+		snprintf(name, sizeof(name), "sieve_workers_%u", 1U << w);
+		bench_samples_report(&worker_samples[w], name, "ns/number");
+		bench_samples_free(&worker_samples[w]);
+	}
+
+	bench_samples_free(&seq_samples);
+	bench_samples_free(&pfor_samples);
+	free(composite);
+	free(base);
+	return 0;
+}
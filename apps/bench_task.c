@@ -0,0 +1,102 @@
+/*
+ * Stackless task and worker pool benchmark
+ *
+ * A thread queues batches of BENCH_BATCH work items which only count
+ * themselves, either as stackless tasks, as threads, or as jobs of a worker pool
+ * submitted one by one or in a single batch, and waits for all of them to have
+ * run. Every batch is timed, and the cost of one work item is reported in each
+ * case.
+ */
+
+#include <pool.h>
+#include <uthread.h>
+
+#include "bench.h"
+
+#define NWORKERS 4
+#define POOL_CAPACITY 256
+
+static unsigned int nops;
+static unsigned int done;
+static struct bench_samples task_samples;
+static struct bench_samples thread_samples;
+static struct bench_samples submit_samples;
+static struct bench_samples batch_samples;
+
+static void item(void *arg)
+{
+	(void)arg;
+
+	done++;
+}
+
+static void driver(void *arg)
+{
+	uthread_pool_t pool = pool_create(NWORKERS, POOL_CAPACITY);
+	struct uthread_pool_job jobs[BENCH_BATCH];
+	unsigned int r, b, i;
+	double start;
+	(void)arg;
+
+	for (i = 0; i < BENCH_BATCH; i++) {
+		jobs[i].func = item;
+		jobs[i].arg = NULL;
+	}
+
+	for (r = 0; r < BENCH_ROUNDS; r++) {
+		for (b = 0; b < nops; b += BENCH_BATCH) {
+			start = bench_now_ns();
+			done = 0;
+			for (i = 0; i < BENCH_BATCH; i++)
+				uthread_spawn_task(item, NULL);
+			while (done < BENCH_BATCH)
+				uthread_yield();
+			start = bench_sample(&task_samples, start, BENCH_BATCH);
+
+			done = 0;
+			for (i = 0; i < BENCH_BATCH; i++)
+				uthread_create(item, NULL);
+			while (done < BENCH_BATCH)
+				uthread_yield();
+			start = bench_sample(&thread_samples, start,
+					     BENCH_BATCH);
+
+			for (i = 0; i < BENCH_BATCH; i++)
+				pool_submit(pool, item, NULL);
+			pool_wait_idle(pool);
+			start = bench_sample(&submit_samples, start,
+					     BENCH_BATCH);
+
+			pool_submit_batch(pool, jobs, BENCH_BATCH);
+			pool_wait_idle(pool);
+			bench_sample(&batch_samples, start, BENCH_BATCH);
+		}
+	}
+
+	pool_destroy(pool);
+}
+
+int main(int argc, char **argv)
+{
+	size_t nbatches;
+
+	nops = bench_ops(argc, argv, 1000);
+	nbatches = (size_t)BENCH_ROUNDS *
+		   ((nops + BENCH_BATCH - 1) / BENCH_BATCH);
+	bench_samples_init(&task_samples, nbatches);
+	bench_samples_init(&thread_samples, nbatches);
+	bench_samples_init(&submit_samples, nbatches);
+	bench_samples_init(&batch_samples, nbatches);
+
+	uthread_run(false, driver, NULL);
+	bench_samples_report(&task_samples, "spawn_task", "ns/item");
+	bench_samples_report(&thread_samples, "create_thread", "ns/item");
+	bench_samples_report(&submit_samples, "pool_submit", "ns/item");
+	bench_samples_report(&batch_samples, "pool_submit_batch", "ns/item");
+
+	bench_samples_free(&task_samples);
+	bench_samples_free(&thread_samples);
+	bench_samples_free(&submit_samples);
+	bench_samples_free(&batch_samples);
+	return 0;
+}
@@ -0,0 +1,157 @@
+/*
+ * Yield ping-pong benchmarks
+ *
+ * - yield_pingpong: two threads repeatedly yield to each other. Reports the
+ *   cost of one context switch through the ready queue, each yield of one
+ *   thread going through two of them before returning.
+ * - yield_roundtrip: same, timing every yield of one thread on its own rather
+ *   than in batches. Reports the cost of the two context switches.
+ * - transfer_pingpong: two threads repeatedly transfer the CPU to each other
+ *   with uthread_switch_to(). Reports the cost of one transfer.
+ * - gen_next: a thread consumes the values of a generator. Reports the cost of
+ *   getting one value (two transfers).
+ */
+
+#include <stdbool.h>
+
+#include <gen.h>
+#include <uthread.h>
+
+#include "bench.h"
+
+static unsigned int nops;
+static bool done;
+static struct bench_samples samples;
+
+/* Number of batches of BENCH_BATCH operations */
+static size_t nbatches;
+
+static void partner(void *arg)
+{
+	(void)arg;
+
+	while (!done)
+		uthread_yield();
+}
+
+static void driver(void *arg)
+{
+	unsigned int i;
+	double start;
+	size_t b;
+	(void)arg;
+
+	done = false;
+	uthread_create(partner, NULL);
+	uthread_yield();
+
+	start = bench_now_ns();
+	for (b = 0; b < nbatches; b++) {
+		for (i = 0; i < BENCH_BATCH; i++)
+			uthread_yield();
+		start = bench_sample(&samples, start, 2.0 * BENCH_BATCH);
+	}
+	done = true;
+}
+
+static void latency_driver(void *arg)
+{
+	size_t i, n = nbatches * BENCH_BATCH;
+	(void)arg;
+
+	done = false;
+	uthread_create(partner, NULL);
+	uthread_yield();
+
+	for (i = 0; i < n; i++) {
+		double start = bench_now_ns();
+
+		uthread_yield();
+		bench_sample(&samples, start, 1);
+	}
+	done = true;
+}
+
+static uthread_t driver_thread;
+
+static void transfer_partner(void *arg)
+{
+	(void)arg;
+
+	while (!done)
+		uthread_switch_to(driver_thread);
+	uthread_resume(driver_thread);
+}
+
+static void transfer_driver(void *arg)
+{
+	unsigned int i;
+	uthread_t partner_thread;
+	double start;
+	size_t b;
+	(void)arg;
+
+	done = false;
+	driver_thread = uthread_self();
+	partner_thread = uthread_create_suspended(transfer_partner, NULL);
+	uthread_switch_to(partner_thread);
+
+	start = bench_now_ns();
+	for (b = 0; b < nbatches; b++) {
+		for (i = 0; i < BENCH_BATCH; i++)
+			uthread_switch_to(partner_thread);
+		start = bench_sample(&samples, start, 2.0 * BENCH_BATCH);
+	}
+	done = true;
+	uthread_switch_to(partner_thread);
+}
+
+static void counter(void *arg)
+{
+	unsigned long i = 0;
+	(void)arg;
+
+	while (uthread_gen_yield((void *)i++) == 0)
+		;
+}
+
+static void consumer(void *arg)
+{
+	uthread_gen_t gen = uthread_gen_create(counter, NULL);
+	unsigned int i;
+	double start;
+	size_t b;
+	void *value;
+	(void)arg;
+
+	start = bench_now_ns();
+	for (b = 0; b < nbatches; b++) {
+		for (i = 0; i < BENCH_BATCH; i++)
+			uthread_gen_next(gen, &value);
+		start = bench_sample(&samples, start, BENCH_BATCH);
+	}
+	uthread_gen_destroy(gen);
+}
+
+int main(int argc, char **argv)
+{
+	nops = bench_ops(argc, argv, 10000);
+	nbatches = ((size_t)BENCH_ROUNDS * nops + BENCH_BATCH - 1) / BENCH_BATCH;
+	bench_samples_init(&samples, nbatches * BENCH_BATCH);
+
+	uthread_run(false, driver, NULL);
+	bench_samples_report(&samples, "yield_pingpong", "ns/switch");
+
+	uthread_run(false, latency_driver, NULL);
+	bench_samples_report(&samples, "yield_roundtrip", "ns/roundtrip");
+
+	uthread_run(false, transfer_driver, NULL);
+	bench_samples_report(&samples, "transfer_pingpong", "ns/transfer");
+
+	uthread_run(false, consumer, NULL);
+	bench_samples_report(&samples, "gen_next", "ns/value");
+
+	bench_samples_free(&samples);
+
+	return 0;
+}
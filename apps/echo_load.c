@@ -0,0 +1,213 @@
+/*
+ * Loopback echo load generator
+ *
+ * Opens a number of connections to the echo server on 127.0.0.1, one thread
+ * per connection. Once all of them are connected, every connection sends a
+ * number of requests of a given size, one at a time, each waiting for the
+ * server to echo it back. Reports the number of requests per second, and the
+ * distribution of their round-trip time.
+ *
+ * Each loopback address only has so many ephemeral ports, so connections are
+ * spread over several source addresses of 127.0.0.0/8.
+ *
+ * Usage: echo_load.x [-p port] [-c connections] [-r requests] [-s size]
+ */
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <barrier.h>
+#include <io.h>
+#include <stack.h>
+#include <uthread.h>
+
+#include "bench.h"
+
+#define DEFAULT_PORT 7007
+#define DEFAULT_CONNS 10000
+#define DEFAULT_REQUESTS 10
+#define DEFAULT_SIZE 64
+
+/* Connections per source address, well below the number of ephemeral ports */
+#define CONNS_PER_ADDR 16384
+
+/* Stack size of the client threads, which need little */
+#define STACK_SIZE 16384
+
+#define MAX_SIZE 4096
+
+static int port;
+static unsigned long nconns, nrequests;
+static size_t size;
+static unsigned long failed;
+
+/*
+ * Latches rather than a barrier, so that the driver can arrive in place of the
+ * clients it failed to create
+ */
+static uthread_latch_t connected, go, done;
+
+/* Round-trip time of each request */
+static double *latencies;
+static size_t nlatencies;
+
+/* Send all of @buf, then read as many bytes back into @reply */
+static int round_trip(int fd, const char *buf, char *reply)
+{
+	size_t off;
+	ssize_t ret;
+
+	for (off = 0; off < size; off += ret) {
+		ret = uthread_write(fd, buf + off, size - off);
+		if (ret < 0)
+			return -1;
+	}
+	for (off = 0; off < size; off += ret) {
+		ret = uthread_read(fd, reply + off, size - off);
+		if (ret <= 0)
+			return -1;
+	}
+	return memcmp(buf, reply, size) ? -1 : 0;
+}
+
+static void client(void *arg)
+{
+	unsigned long i = (uintptr_t)arg, r;
+	struct sockaddr_in src = { .sin_family = AF_INET };
+	struct sockaddr_in dst = { .sin_family = AF_INET };
+	char buf[MAX_SIZE], reply[MAX_SIZE];
+	int fd, one = 1;
+
+	src.sin_addr.s_addr = htonl(INADDR_LOOPBACK + i / CONNS_PER_ADDR);
+	dst.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	dst.sin_port = htons(port);
+	memset(buf, 'a' + i % 26, size);
+
+	/* Let connect() pick the port, for the source address alone */
+	fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd >= 0) {
+		setsockopt(fd, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT, &one,
+			   sizeof(one));
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	}
+	if (fd < 0 || bind(fd, (struct sockaddr *)&src, sizeof(src)) == -1 ||
+	    uthread_connect(fd, (struct sockaddr *)&dst, sizeof(dst)) == -1) {
+		if (!failed++)
+			perror("connect");
+		if (fd >= 0)
+			close(fd);
+		fd = -1;
+	}
+
+	/* Start sending once every connection is open */
+	uthread_latch_count_down(connected);
+	uthread_latch_wait(go);
+
+	for (r = 0; fd >= 0 && r < nrequests; r++) {
+		double start = bench_now_ns();
+
+		if (round_trip(fd, buf, reply) == -1) {
+			failed++;
+			break;
+		}
+		latencies[nlatencies++] = bench_now_ns() - start;
+	}
+
+	if (fd >= 0)
+		close(fd);
+	uthread_latch_count_down(done);
+}
+
+static void driver(void *arg)
+{
+	double start;
+	unsigned long i;
+	(void)arg;
+
+	connected = uthread_latch_create(nconns);
+	go = uthread_latch_create(1);
+	done = uthread_latch_create(nconns);
+	for (i = 0; i < nconns; i++) {
+		if (uthread_create(client, (void *)(uintptr_t)i) == -1) {
+			if (!failed++)
+				fprintf(stderr, "Failed to create a client\n");
+			uthread_latch_count_down(connected);
+			uthread_latch_count_down(done);
+		}
+	}
+
+	uthread_latch_wait(connected);
+	uthread_latch_count_down(go);
+	start = bench_now_ns();
+	uthread_latch_wait(done);
+
+	bench_report_requests("echo_load", latencies, nlatencies,
+			      bench_now_ns() - start);
+	uthread_latch_destroy(connected);
+	uthread_latch_destroy(go);
+	uthread_latch_destroy(done);
+}
+
+int main(int argc, char **argv)
+{
+	int opt;
+
+	port = DEFAULT_PORT;
+	nconns = DEFAULT_CONNS;
+	nrequests = DEFAULT_REQUESTS;
+	size = DEFAULT_SIZE;
+	while ((opt = getopt(argc, argv, "p:c:r:s:")) != -1) {
+		switch (opt) {
+		case 'p':
+			port = atoi(optarg);
+			break;
+		case 'c':
+			nconns = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			nrequests = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			size = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-p port] [-c connections] "
+				"[-r requests] [-s size]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (!nconns || !size || size > MAX_SIZE) {
+		fprintf(stderr, "Invalid parameters\n");
+		return 1;
+	}
+
+	if (bench_nofile(nconns + 16) == -1) {
+		fprintf(stderr, "Cannot open %lu files, raise the limit\n",
+			nconns + 16);
+		return 1;
+	}
+
+	latencies = malloc(nconns * nrequests * sizeof(*latencies));
+	if (!latencies) {
+		perror("malloc");
+		return 1;
+	}
+
+	uthread_stack_arena(nconns + 1, STACK_SIZE, false);
+	uthread_run(false, driver, NULL);
+	uthread_stack_arena(0, 0, false);
+
+	free(latencies);
+	if (failed) {
+		fprintf(stderr, "%lu connections failed\n", failed);
+		return 1;
+	}
+	return 0;
+}
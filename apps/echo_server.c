@@ -0,0 +1,157 @@
+/*
+ * Loopback echo server
+ *
+ * Thread-per-connection TCP echo server listening on 127.0.0.1, built on the
+ * I/O wrappers of the library. It serves a given number of connections, then
+ * reports how many requests (reads echoed back) it served per second, from
+ * the first connection accepted to the last one closed, and the distribution
+ * of the time taken to echo a request back.
+ *
+ * Usage: echo_server.x [-p port] [-n connections]
+ *
+ * Meant to be driven by echo_load.x, e.g.:
+ *
+ *	./echo_server.x -n 10000 & ./echo_load.x -c 10000
+ */
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <io.h>
+#include <stack.h>
+#include <uthread.h>
+
+#include "bench.h"
+
+#define DEFAULT_PORT 7007
+#define DEFAULT_CONNS 10000
+
+/* Stack size of the connection threads, which need little */
+#define STACK_SIZE 16384
+
+#define BUF_SIZE 4096
+
+static int listen_fd;
+static unsigned long nconns;
+static double first, last;
+
+/* Time taken to echo each request back */
+static double *latencies;
+static size_t nlatencies, capacity;
+
+static void record(double latency)
+{
+	if (nlatencies == capacity) {
+		capacity = capacity ? 2 * capacity : 4096;
+		latencies = realloc(latencies, capacity * sizeof(*latencies));
+		if (!latencies) {
+			perror("realloc");
+			exit(1);
+		}
+	}
+	latencies[nlatencies++] = latency;
+}
+
+static void connection(void *arg)
+{
+	int fd = (int)(intptr_t)arg;
+	char buf[BUF_SIZE];
+	ssize_t n, off, ret;
+
+	while ((n = uthread_read(fd, buf, sizeof(buf))) > 0) {
+		double start = bench_now_ns();
+
+		for (off = 0; off < n; off += ret) {
+			ret = uthread_write(fd, buf + off, n - off);
+			if (ret < 0)
+				goto out;
+		}
+		record(bench_now_ns() - start);
+	}
+
+out:
+	close(fd);
+	last = bench_now_ns();
+}
+
+static void acceptor(void *arg)
+{
+	unsigned long accepted;
+	int one = 1;
+	(void)arg;
+
+	for (accepted = 0; accepted < nconns; accepted++) {
+		int fd = uthread_accept(listen_fd, NULL, NULL);
+
+		if (fd < 0) {
+			perror("accept");
+			break;
+		}
+		if (!accepted)
+			first = bench_now_ns();
+
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		if (uthread_create(connection, (void *)(intptr_t)fd) == -1) {
+			fprintf(stderr, "Cannot create connection thread\n");
+			close(fd);
+		}
+	}
+	close(listen_fd);
+}
+
+int main(int argc, char **argv)
+{
+	struct sockaddr_in addr = { .sin_family = AF_INET };
+	int port = DEFAULT_PORT, one = 1, opt;
+
+	nconns = DEFAULT_CONNS;
+	while ((opt = getopt(argc, argv, "p:n:")) != -1) {
+		switch (opt) {
+		case 'p':
+			port = atoi(optarg);
+			break;
+		case 'n':
+			nconns = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-p port] [-n connections]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+
+	if (bench_nofile(nconns + 16) == -1) {
+		fprintf(stderr, "Cannot open %lu files, raise the limit\n",
+			nconns + 16);
+		return 1;
+	}
+
+	listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+			   0);
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (listen_fd < 0 ||
+	    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one,
+		       sizeof(one)) == -1 ||
+	    bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) == -1 ||
+	    listen(listen_fd, SOMAXCONN) == -1) {
+		perror("listen");
+		return 1;
+	}
+
+	/* Connection threads come and go, their stacks in a single mapping */
+	uthread_stack_arena(nconns + 1, STACK_SIZE, false);
+	uthread_run(false, acceptor, NULL);
+	uthread_stack_arena(0, 0, false);
+
+	bench_report_requests("echo_server", latencies, nlatencies,
+			      last - first);
+	free(latencies);
+	return 0;
+}
@@ -1,6 +1,7 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 
 #include <queue.h>
 
@@ -154,6 +155,37 @@ void test_dequeue_empty(void) {
     queue_destroy(q);
 }
 
+/* Test peeking at the oldest item, for both kinds of queues */
+void test_peek(void) {
+    int data1 = 1, data2 = 2;
+    int *item;
+    queue_t queues[2];
+    int k;
+
+    fprintf(stderr, "*** TEST peek ***\n");
+
+    queues[0] = queue_create();
+    queues[1] = queue_create_ring();
+    for (k = 0; k < 2; k++) {
+        queue_t q = queues[k];
+
+        TEST_ASSERT(queue_peek(q, (void **)&item) == -1);
+        queue_enqueue(q, &data1);
+        queue_enqueue(q, &data2);
+
+        // Peeking leaves the item in the queue
+        TEST_ASSERT(queue_peek(q, (void **)&item) == 0 && item == &data1);
+        TEST_ASSERT(queue_length(q) == 2);
+        queue_dequeue(q, (void **)&item);
+        TEST_ASSERT(queue_peek(q, (void **)&item) == 0 && item == &data2);
+        TEST_ASSERT(queue_peek(NULL, (void **)&item) == -1);
+        TEST_ASSERT(queue_peek(q, NULL) == -1);
+
+        queue_dequeue(q, (void **)&item);
+        queue_destroy(q);
+    }
+}
+
 /* Test deleting items from the queue */
 void test_delete(void) {
     queue_t q;
@@ -253,6 +285,258 @@ void test_print_queue(void) {
     queue_destroy(q);
 }
 
+/* Test basic enqueue and dequeue functionality of a ring buffer queue */
+void test_ring_simple(void) {
+    int data1 = 1, data2 = 2, *ptr;
+    queue_t q;
+
+    fprintf(stderr, "*** TEST ring_simple ***\n");
+
+    // Create a new ring buffer queue and enqueue two items
+    q = queue_create_ring();
+    TEST_ASSERT(q != NULL);
+    queue_enqueue(q, &data1);
+    queue_enqueue(q, &data2);
+    TEST_ASSERT(queue_length(q) == 2);
+
+    // Dequeue the items in FIFO order
+    queue_dequeue(q, (void **) &ptr);
+    TEST_ASSERT(ptr == &data1);
+    queue_dequeue(q, (void **) &ptr);
+    TEST_ASSERT(ptr == &data2);
+    TEST_ASSERT(queue_dequeue(q, (void **) &ptr) == -1);
+
+    TEST_ASSERT(queue_destroy(q) == 0);
+}
+
+/* Test that a ring buffer queue keeps FIFO order when wrapping and growing */
+void test_ring_grow(void) {
+    int data[100];
+    int *ptr;
+    int i, ok = 1;
+    queue_t q;
+
+    fprintf(stderr, "*** TEST ring_grow ***\n");
+
+    // Move the oldest item away from the start of the buffer, then grow it
+    q = queue_create_ring();
+    for (i = 0; i < 10; i++) {
+        queue_enqueue(q, &data[i]);
+    }
+    for (i = 0; i < 10; i++) {
+        queue_dequeue(q, (void **) &ptr);
+    }
+    for (i = 0; i < 100; i++) {
+        queue_enqueue(q, &data[i]);
+    }
+    TEST_ASSERT(queue_length(q) == 100);
+
+    for (i = 0; i < 100; i++) {
+        queue_dequeue(q, (void **) &ptr);
+        ok &= (ptr == &data[i]);
+    }
+    TEST_ASSERT(ok);
+    TEST_ASSERT(queue_length(q) == 0);
+
+    queue_destroy(q);
+}
+
+/* Test deleting items from a ring buffer queue */
+void test_ring_delete(void) {
+    int data1 = 1, data2 = 2, data3 = 3;
+    int *ptr;
+    queue_t q;
+
+    fprintf(stderr, "*** TEST ring_delete ***\n");
+
+    q = queue_create_ring();
+    queue_enqueue(q, &data1);
+    queue_enqueue(q, &data2);
+    queue_enqueue(q, &data3);
+
+    // Delete the item in the middle, and check the order of the others
+    TEST_ASSERT(queue_delete(q, &data2) == 0);
+    TEST_ASSERT(queue_delete(q, &data2) == -1);
+    TEST_ASSERT(queue_length(q) == 2);
+    queue_dequeue(q, (void **) &ptr);
+    TEST_ASSERT(ptr == &data1);
+    queue_dequeue(q, (void **) &ptr);
+    TEST_ASSERT(ptr == &data3);
+
+    queue_destroy(q);
+}
+
+/* Test iterating through a ring buffer queue while deleting items */
+void test_ring_iterator(void) {
+    queue_t q;
+    int data[] = {1, 2, 42, 3, 42, 4};
+    int *ptr;
+    size_t i;
+
+    fprintf(stderr, "*** TEST ring_iterator ***\n");
+
+    /*
+     * Initialize the queue and enqueue items, including two '42' and the first
+     * of them once more at the tail
+     */
+    q = queue_create_ring();
+    for (i = 0; i < sizeof(data) / sizeof(data[0]); i++)
+        queue_enqueue(q, &data[i]);
+    queue_enqueue(q, &data[2]);
+
+    /* Increment every item of the queue, delete items '42' */
+    queue_iterate(q, iterator_inc);
+    TEST_ASSERT(data[0] == 2 && data[1] == 3 && data[3] == 4 && data[5] == 5);
+    TEST_ASSERT(queue_length(q) == 4);
+
+    /* The remaining items are left in order */
+    queue_dequeue(q, (void **) &ptr);
+    TEST_ASSERT(ptr == &data[0]);
+    queue_dequeue(q, (void **) &ptr);
+    TEST_ASSERT(ptr == &data[1]);
+    queue_dequeue(q, (void **) &ptr);
+    TEST_ASSERT(ptr == &data[3]);
+    queue_dequeue(q, (void **) &ptr);
+    TEST_ASSERT(ptr == &data[5]);
+
+    TEST_ASSERT(queue_destroy(q) == 0);
+}
+
+/* Test enqueueing and dequeueing several items at once */
+void test_batch(void) {
+    int data[] = {1, 2, 3, 4, 5};
+    void *items[] = {&data[0], &data[1], &data[2], &data[3], &data[4]};
+    void *out[8];
+    queue_t queues[2];
+    int i, k;
+
+    fprintf(stderr, "*** TEST batch ***\n");
+
+    queues[0] = queue_create();
+    queues[1] = queue_create_ring();
+    for (k = 0; k < 2; k++) {
+        queue_t q = queues[k];
+        int ok = 1;
+
+        // A batch with a NULL item is rejected as a whole
+        items[4] = NULL;
+        TEST_ASSERT(queue_enqueue_batch(q, items, 5) == -1);
+        TEST_ASSERT(queue_length(q) == 0);
+        items[4] = &data[4];
+
+        queue_enqueue(q, &data[0]);
+        TEST_ASSERT(queue_enqueue_batch(q, &items[1], 4) == 0);
+        TEST_ASSERT(queue_length(q) == 5);
+
+        // Dequeue fewer items than available, then more
+        TEST_ASSERT(queue_dequeue_batch(q, out, 2) == 2);
+        TEST_ASSERT(out[0] == &data[0] && out[1] == &data[1]);
+        TEST_ASSERT(queue_dequeue_batch(q, out, 8) == 3);
+        for (i = 0; i < 3; i++) {
+            ok &= (out[i] == &data[i + 2]);
+        }
+        TEST_ASSERT(ok);
+        TEST_ASSERT(queue_dequeue_batch(q, out, 8) == 0);
+
+        queue_destroy(q);
+    }
+}
+
+/* Test concatenating queues of both kinds */
+void test_splice(void) {
+    int data[] = {1, 2, 3, 4};
+    queue_t (*create[])(void) = {queue_create, queue_create_ring};
+    int *ptr;
+    int i, j, k;
+
+    fprintf(stderr, "*** TEST splice ***\n");
+
+    for (i = 0; i < 2; i++) {
+        for (j = 0; j < 2; j++) {
+            queue_t dst = create[i]();
+            queue_t src = create[j]();
+            int ok = 1;
+
+            queue_enqueue(dst, &data[0]);
+            queue_enqueue(dst, &data[1]);
+            queue_enqueue(src, &data[2]);
+            queue_enqueue(src, &data[3]);
+
+            TEST_ASSERT(queue_splice(dst, src) == 0);
+            TEST_ASSERT(queue_length(dst) == 4 && queue_length(src) == 0);
+            for (k = 0; k < 4; k++) {
+                queue_dequeue(dst, (void **) &ptr);
+                ok &= (ptr == &data[k]);
+            }
+            TEST_ASSERT(ok);
+
+            // Splicing into an empty queue, and reusing the emptied queue
+            queue_enqueue(src, &data[0]);
+            TEST_ASSERT(queue_splice(dst, src) == 0);
+            queue_enqueue(src, &data[1]);
+            TEST_ASSERT(queue_splice(dst, src) == 0);
+            TEST_ASSERT(queue_length(dst) == 2);
+            TEST_ASSERT(queue_splice(dst, dst) == -1);
+
+            queue_dequeue(dst, (void **) &ptr);
+            queue_dequeue(dst, (void **) &ptr);
+            queue_destroy(dst);
+            queue_destroy(src);
+        }
+    }
+}
+
+/* Callback function used to walk a queue in the throughput comparison */
+static void iterator_nop(queue_t q, void *data) {
+    (void)q;
+    (void)data;
+}
+
+/* Time @rounds rounds of filling and draining a queue of @n items */
+static double queue_throughput(queue_t q, int n, int rounds) {
+    struct timespec start, end;
+    void *ptr;
+    int r, i;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (r = 0; r < rounds; r++) {
+        for (i = 0; i < n; i++) {
+            queue_enqueue(q, &ptr);
+        }
+        queue_iterate(q, iterator_nop);
+        for (i = 0; i < n; i++) {
+            queue_dequeue(q, &ptr);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec))
+        / ((double)n * rounds);
+}
+
+/* Compare the throughput of the linked list and ring buffer queues */
+void test_throughput(void) {
+    int sizes[] = {16, 1024, 65536};
+    size_t i;
+
+    fprintf(stderr, "*** TEST throughput ***\n");
+
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        queue_t list = queue_create();
+        queue_t ring = queue_create_ring();
+        int rounds = 1000000 / sizes[i];
+
+        printf("%6d items: queue_create %.1f ns/item, "
+               "queue_create_ring %.1f ns/item\n", sizes[i],
+               queue_throughput(list, sizes[i], rounds),
+               queue_throughput(ring, sizes[i], rounds));
+        TEST_ASSERT(queue_length(list) == 0 && queue_length(ring) == 0);
+
+        queue_destroy(list);
+        queue_destroy(ring);
+    }
+}
+
 int main(void) {
     test_create();
     test_queue_simple();
@@ -260,10 +544,18 @@ int main(void) {
     test_enqueue_length();
     test_dequeue();
     test_dequeue_empty();
+    test_peek();
     test_delete();
     test_delete_null();
     test_destroy_non_empty();
     test_print_queue();
+    test_ring_simple();
+    test_ring_grow();
+    test_ring_delete();
+    test_ring_iterator();
+    test_batch();
+    test_splice();
+    test_throughput();
 
     return 0;
 }
@@ -0,0 +1,101 @@
+/*
+ * Asynchronous semaphore release test
+ *
+ * A pthread and a timer signal handler, both running outside of the uthread
+ * runtime, wake uthreads up with sem_up_async(). The uthreads block on the
+ * semaphores most of the time, so the idle thread sleeps in between and has
+ * to be woken up as well.
+ */
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include <sem.h>
+#include <uthread.h>
+
+#define TEST_ASSERT(assert)				\
+do {									\
+	printf("ASSERT: " #assert " ... ");	\
+	if (assert) {						\
+		printf("PASS\n");				\
+	} else	{							\
+		printf("FAIL\n");				\
+		exit(1);						\
+	}									\
+} while(0)
+
+#define NPOSTS 1000
+#define NTICKS 5
+
+static sem_t from_pthread, from_signal;
+static int received_pthread, received_signal;
+
+static void *poster(void *arg)
+{
+	struct timespec delay = { 0, 10000 };
+	int i;
+	(void)arg;
+
+	for (i = 0; i < NPOSTS; i++) {
+		sem_up_async(from_pthread);
+		/* Give the idle thread a chance to fall asleep every now and then */
+		if (i % 100 == 0)
+			nanosleep(&delay, NULL);
+	}
+	return NULL;
+}
+
+static void tick(int sig)
+{
+	(void)sig;
+	sem_up_async(from_signal);
+}
+
+static void signal_waiter(void *arg)
+{
+	(void)arg;
+
+	while (received_signal < NTICKS) {
+		sem_down(from_signal);
+		received_signal++;
+	}
+}
+
+static void pthread_waiter(void *arg)
+{
+	(void)arg;
+
+	uthread_create(signal_waiter, NULL);
+	while (received_pthread < NPOSTS) {
+		sem_down(from_pthread);
+		received_pthread++;
+	}
+}
+
+int main(void)
+{
+	struct itimerval timer = { { 0, 2000 }, { 0, 2000 } };
+	struct itimerval stop = { { 0, 0 }, { 0, 0 } };
+	pthread_t thread;
+
+	from_pthread = sem_create(0);
+	from_signal = sem_create(0);
+
+	signal(SIGALRM, tick);
+	setitimer(ITIMER_REAL, &timer, NULL);
+	pthread_create(&thread, NULL, poster, NULL);
+
+	uthread_run(false, pthread_waiter, NULL);
+
+	setitimer(ITIMER_REAL, &stop, NULL);
+	pthread_join(thread, NULL);
+
+	TEST_ASSERT(received_pthread == NPOSTS);
+	TEST_ASSERT(received_signal == NTICKS);
+
+	return 0;
+}
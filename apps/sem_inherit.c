@@ -0,0 +1,293 @@
+/*
+ * Priority inheritance test
+ *
+ * Under the priority policy, a thread of low priority holding a mutex must not
+ * keep a thread of high priority waiting behind a busy thread of medium
+ * priority: the owner inherits the priority of the waiter, including through a
+ * chain of locks, and gets its own back once it unlocks. The same goes for
+ * threads waiting on locks through uthread_select().
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <mutex.h>
+#include <sem.h>
+#include <uthread.h>
+#include <uthread_sched.h>
+
+#define TEST_ASSERT(assert)				\
+do {									\
+	printf("ASSERT: " #assert " ... ");	\
+	if (assert) {						\
+		printf("PASS\n");				\
+	} else	{							\
+		printf("FAIL\n");				\
+		exit(1);						\
+	}									\
+} while(0)
+
+#define LOW 1
+#define MEDIUM 4
+#define HIGH 7
+
+/* Yields the medium thread makes before giving up on the high one */
+#define PATIENCE 1000
+
+static mutex_t lock_a, lock_b;
+static sem_t gate, gate2, never;
+static uthread_t low_thread, mid_thread;
+static bool high_done;
+static int low_boosted, low_after, medium_yields;
+static int chain_low, chain_mid;
+static int selected, select_low;
+
+/* Create a thread of priority @prio, the caller keeping its own */
+static void create_at(int prio, uthread_func_t func)
+{
+	int own = uthread_get_priority(uthread_self());
+
+	uthread_set_priority(uthread_self(), prio);
+	uthread_create(func, NULL);
+	uthread_set_priority(uthread_self(), own);
+}
+
+static void low(void *arg)
+{
+	(void)arg;
+
+	low_thread = uthread_self();
+	mutex_lock(lock_a);
+	sem_down(gate);
+	low_boosted = uthread_get_priority(low_thread);
+	mutex_unlock(lock_a);
+	low_after = uthread_get_priority(low_thread);
+}
+
+static void high(void *arg)
+{
+	(void)arg;
+
+	mutex_lock(lock_a);
+	high_done = true;
+	mutex_unlock(lock_a);
+}
+
+static void medium(void *arg)
+{
+	(void)arg;
+
+	/* The owner is runnable, and must be moved up once high blocks */
+	sem_up(gate);
+	create_at(HIGH, high);
+	uthread_yield();
+
+	while (!high_done && medium_yields < PATIENCE) {
+		medium_yields++;
+		uthread_yield();
+	}
+}
+
+static void test_inversion(void *arg)
+{
+	(void)arg;
+
+	create_at(LOW, low);
+	uthread_yield();
+	create_at(MEDIUM, medium);
+}
+
+/* Chain: low holds A, mid holds B and waits for A, high waits for B */
+static void chain_low_main(void *arg)
+{
+	(void)arg;
+
+	low_thread = uthread_self();
+	mutex_lock(lock_a);
+	sem_down(gate);
+	mutex_unlock(lock_a);
+	low_after = uthread_get_priority(low_thread);
+}
+
+static void chain_mid_main(void *arg)
+{
+	(void)arg;
+
+	mid_thread = uthread_self();
+	mutex_lock(lock_b);
+	mutex_lock(lock_a);
+	mutex_unlock(lock_a);
+	mutex_unlock(lock_b);
+}
+
+static void chain_high_main(void *arg)
+{
+	(void)arg;
+
+	mutex_lock(lock_b);
+	high_done = true;
+	mutex_unlock(lock_b);
+}
+
+static void test_chain(void *arg)
+{
+	(void)arg;
+
+	create_at(LOW, chain_low_main);
+	uthread_yield();
+	create_at(MEDIUM, chain_mid_main);
+	uthread_yield();
+	TEST_ASSERT(uthread_get_priority(low_thread) == MEDIUM);
+
+	create_at(HIGH, chain_high_main);
+	uthread_yield();
+	chain_low = uthread_get_priority(low_thread);
+	chain_mid = uthread_get_priority(mid_thread);
+	TEST_ASSERT(chain_low == HIGH && chain_mid == HIGH);
+
+	sem_up(gate);
+	while (!high_done)
+		uthread_yield();
+	TEST_ASSERT(uthread_get_priority(uthread_self()) == 0);
+}
+
+static struct timespec in_ms(long ms)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	ts.tv_nsec += ms * 1000000;
+	ts.tv_sec += ts.tv_nsec / 1000000000;
+	ts.tv_nsec %= 1000000000;
+	return ts;
+}
+
+/* Wait for lock A through a select, among a semaphore never released */
+static void select_high(void *arg)
+{
+	sem_t sems[2] = { never, lock_a };
+	(void)arg;
+
+	selected = uthread_select(sems, 2, NULL);
+	high_done = true;
+	mutex_unlock(lock_a);
+}
+
+/* Same as chain_mid_main(), waiting for lock A through a select */
+static void select_mid(void *arg)
+{
+	sem_t sems[2] = { never, lock_a };
+	(void)arg;
+
+	mid_thread = uthread_self();
+	mutex_lock(lock_b);
+	selected = uthread_select(sems, 2, NULL);
+	mutex_unlock(lock_a);
+	mutex_unlock(lock_b);
+}
+
+/* Give up waiting for lock A through a select at a deadline */
+static void select_timeout(void *arg)
+{
+	sem_t sems[1] = { lock_a };
+	struct timespec deadline = in_ms(20);
+	(void)arg;
+
+	selected = uthread_select(sems, 1, &deadline);
+	select_low = uthread_get_priority(low_thread);
+	sem_up(gate2);
+}
+
+static void test_select(void *arg)
+{
+	(void)arg;
+
+	/* A single select waiter */
+	high_done = false;
+	create_at(LOW, chain_low_main);
+	uthread_yield();
+	create_at(HIGH, select_high);
+	uthread_yield();
+	TEST_ASSERT(uthread_get_priority(low_thread) == HIGH);
+	sem_up(gate);
+	while (!high_done)
+		uthread_yield();
+	TEST_ASSERT(selected == 1 && low_after == LOW);
+
+	/* A select waiter in the middle of a chain */
+	high_done = false;
+	create_at(LOW, chain_low_main);
+	uthread_yield();
+	create_at(MEDIUM, select_mid);
+	uthread_yield();
+	create_at(HIGH, chain_high_main);
+	uthread_yield();
+	chain_low = uthread_get_priority(low_thread);
+	chain_mid = uthread_get_priority(mid_thread);
+	TEST_ASSERT(chain_low == HIGH && chain_mid == HIGH);
+	sem_up(gate);
+	while (!high_done)
+		uthread_yield();
+	TEST_ASSERT(selected == 1);
+
+	/* The boost is given back when the select times out */
+	create_at(LOW, chain_low_main);
+	uthread_yield();
+	create_at(HIGH, select_timeout);
+	uthread_yield();
+	TEST_ASSERT(uthread_get_priority(low_thread) == HIGH);
+	sem_down(gate2);
+	TEST_ASSERT(selected == 1 && select_low == LOW);
+	sem_up(gate);
+}
+
+static void test_errors(void *arg)
+{
+	(void)arg;
+
+	TEST_ASSERT(mutex_unlock(lock_a) == -1);
+	TEST_ASSERT(mutex_lock(lock_a) == 0);
+	TEST_ASSERT(mutex_lock(lock_a) == -1);
+	TEST_ASSERT(sem_down_n(lock_a, 2) == -1);
+	TEST_ASSERT(sem_up_async(lock_a) == -1);
+	TEST_ASSERT(uthread_select(&lock_a, 1, NULL) == -1);
+	TEST_ASSERT(mutex_destroy(lock_a) == -1);
+	TEST_ASSERT(mutex_unlock(lock_a) == 0);
+}
+
+int main(void)
+{
+	int ret;
+
+	lock_a = mutex_create("a");
+	lock_b = mutex_create("b");
+	gate = sem_create(0);
+	gate2 = sem_create(0);
+	never = sem_create(0);
+
+	ret = uthread_run_policy(false, &uthread_sched_prio, test_inversion,
+				 NULL);
+	TEST_ASSERT(ret == 0);
+	TEST_ASSERT(low_boosted == HIGH);
+	TEST_ASSERT(low_after == LOW);
+	TEST_ASSERT(high_done && medium_yields < PATIENCE);
+
+	high_done = false;
+	ret = uthread_run_policy(false, &uthread_sched_prio, test_chain, NULL);
+	TEST_ASSERT(ret == 0);
+
+	ret = uthread_run_policy(false, &uthread_sched_prio, test_select, NULL);
+	TEST_ASSERT(ret == 0);
+
+	ret = uthread_run_policy(false, &uthread_sched_prio, test_errors, NULL);
+	TEST_ASSERT(ret == 0);
+
+	TEST_ASSERT(mutex_destroy(lock_a) == 0);
+	TEST_ASSERT(mutex_destroy(lock_b) == 0);
+	TEST_ASSERT(sem_destroy(gate) == 0);
+	TEST_ASSERT(sem_destroy(gate2) == 0);
+	TEST_ASSERT(sem_destroy(never) == 0);
+	return 0;
+}
@@ -0,0 +1,97 @@
+/*
+ * Multi-unit semaphore test
+ *
+ * A thread waiting for several resources at once must neither take part of
+ * them while waiting, nor be overtaken by a later thread waiting for fewer.
+ * Releasing several resources at once must wake up as many waiters as they
+ * cover, in FIFO order.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <sem.h>
+#include <uthread.h>
+
+#define TEST_ASSERT(assert)				\
+do {									\
+	printf("ASSERT: " #assert " ... ");	\
+	if (assert) {						\
+		printf("PASS\n");				\
+	} else	{							\
+		printf("FAIL\n");				\
+		exit(1);						\
+	}									\
+} while(0)
+
+static sem_t sem;
+static char order[8];
+static int norder;
+
+static void take_three(void *arg)
+{
+	(void)arg;
+
+	sem_down_n(sem, 3);
+	order[norder++] = '3';
+}
+
+static void take_one(void *arg)
+{
+	sem_down(sem);
+	order[norder++] = *(char *)arg;
+}
+
+static void main_thread(void *arg)
+{
+	(void)arg;
+
+	/* Resources available right away are taken without blocking */
+	sem_up_n(sem, 2);
+	TEST_ASSERT(sem_down_n(sem, 2) == 0);
+	TEST_ASSERT(sem_down_n(sem, 0) == -1 && sem_up_n(sem, 0) == -1);
+
+	/* The thread waiting for 3 resources is first in line */
+	uthread_create(take_three, NULL);
+	uthread_create(take_one, "a");
+	uthread_yield();
+
+	/* Not enough for the first waiter, and the second one must wait behind */
+	sem_up_n(sem, 2);
+	uthread_yield();
+	TEST_ASSERT(norder == 0);
+
+	/* Enough for the first waiter, then for the second one */
+	sem_up(sem);
+	uthread_yield();
+	TEST_ASSERT(norder == 1 && order[0] == '3');
+	sem_up(sem);
+	uthread_yield();
+	TEST_ASSERT(norder == 2 && order[1] == 'a');
+
+	/* One batch release wakes up all the waiters it covers, in order */
+	norder = 0;
+	uthread_create(take_one, "b");
+	uthread_create(take_one, "c");
+	uthread_create(take_one, "d");
+	uthread_yield();
+	sem_up_n(sem, 2);
+	uthread_yield();
+	TEST_ASSERT(norder == 2 && order[0] == 'b' && order[1] == 'c');
+	sem_up_n(sem, 4);
+	uthread_yield();
+	TEST_ASSERT(norder == 3 && order[2] == 'd');
+
+	/* The leftover resources stay available */
+	TEST_ASSERT(sem_down_n(sem, 3) == 0);
+}
+
+int main(void)
+{
+	sem = sem_create(0);
+	uthread_run(false, main_thread, NULL);
+	TEST_ASSERT(sem_destroy(sem) == 0);
+
+	return 0;
+}
@@ -0,0 +1,108 @@
+/*
+ * Semaphore contention profiling test
+ *
+ * Several threads fight over a named lock, holding it across yields, while
+ * another named semaphore is only ever taken without waiting. The counters must
+ * reflect both, and the report must list the contended semaphore first.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sem.h>
+#include <uthread.h>
+
+#define TEST_ASSERT(assert)				\
+do {									\
+	printf("ASSERT: " #assert " ... ");	\
+	if (assert) {						\
+		printf("PASS\n");				\
+	} else	{							\
+		printf("FAIL\n");				\
+		exit(1);						\
+	}									\
+} while(0)
+
+#define NTHREADS 4
+#define NROUNDS 10
+
+static sem_t hot, cold, anonymous;
+
+static void worker(void *arg)
+{
+	int i;
+	(void)arg;
+
+	for (i = 0; i < NROUNDS; i++) {
+		sem_down(hot);
+		uthread_yield();
+		sem_up(hot);
+
+		sem_down(cold);
+		sem_up(cold);
+		uthread_yield();
+	}
+}
+
+static void spawner(void *arg)
+{
+	int i;
+	(void)arg;
+
+	for (i = 0; i < NTHREADS; i++)
+		uthread_create(worker, NULL);
+}
+
+int main(void)
+{
+	struct sem_stats st;
+	char *buf = NULL, *line, *save;
+	size_t len = 0;
+	FILE *f;
+	int ret;
+
+	hot = sem_create_named(1, "hot");
+	cold = sem_create_named(1, "cold");
+	anonymous = sem_create(0);
+	ret = uthread_run(false, spawner, NULL);
+	TEST_ASSERT(ret == 0);
+
+	TEST_ASSERT(sem_stats_get(hot, &st) == 0);
+	TEST_ASSERT(st.acquisitions == NTHREADS * NROUNDS);
+	TEST_ASSERT(st.contended > 0);
+	TEST_ASSERT(st.max_waiters == NTHREADS - 1);
+	TEST_ASSERT(st.wait_ns > 0 && st.max_wait_ns <= st.wait_ns);
+
+	TEST_ASSERT(sem_stats_get(cold, &st) == 0);
+	TEST_ASSERT(st.acquisitions == NTHREADS * NROUNDS);
+	TEST_ASSERT(st.contended == 0 && st.wait_ns == 0);
+	TEST_ASSERT(st.max_waiters == 0);
+
+	TEST_ASSERT(sem_stats_get(NULL, &st) == -1);
+	TEST_ASSERT(sem_report(NULL) == -1);
+
+	/* The contended semaphore comes right after the header */
+	f = open_memstream(&buf, &len);
+	TEST_ASSERT(sem_report(f) == 0);
+	fclose(f);
+	line = strtok_r(buf, "\n", &save);
+	line = strtok_r(NULL, "\n", &save);
+	TEST_ASSERT(line && !strncmp(line, "hot ", 4));
+	TEST_ASSERT(strstr(save, "cold ") != NULL);
+	free(buf);
+
+	TEST_ASSERT(sem_destroy(hot) == 0);
+	TEST_ASSERT(sem_destroy(cold) == 0);
+	TEST_ASSERT(sem_destroy(anonymous) == 0);
+
+	/* Destroyed semaphores leave the report */
+	buf = NULL;
+	f = open_memstream(&buf, &len);
+	TEST_ASSERT(sem_report(f) == 0);
+	fclose(f);
+	TEST_ASSERT(strstr(buf, "hot") == NULL);
+	free(buf);
+	return 0;
+}
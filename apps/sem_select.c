@@ -0,0 +1,176 @@
+/*
+ * Select test
+ *
+ * Threads wait on several semaphores at once with uthread_select(), and must
+ * get the first one released, or give up at their deadline, without leaving
+ * registrations behind on the other semaphores (which could then not be
+ * destroyed).
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <sem.h>
+#include <uthread.h>
+
+#define TEST_ASSERT(assert)				\
+do {									\
+	printf("ASSERT: " #assert " ... ");	\
+	if (assert) {						\
+		printf("PASS\n");				\
+	} else	{							\
+		printf("FAIL\n");				\
+		exit(1);						\
+	}									\
+} while(0)
+
+#define NSEMS 16
+#define TIMEOUT_MS 20
+
+static sem_t sems[NSEMS];
+static int selected = -1;
+static int order[2], norder;
+
+static double now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static struct timespec in_ms(long ms)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	ts.tv_nsec += ms * 1000000;
+	ts.tv_sec += ts.tv_nsec / 1000000000;
+	ts.tv_nsec %= 1000000000;
+	return ts;
+}
+
+static void selector(void *arg)
+{
+	size_t n = (size_t)arg;
+
+	selected = uthread_select(sems, n, NULL);
+}
+
+static void timed_selector(void *arg)
+{
+	struct timespec deadline = in_ms(1000);
+	(void)arg;
+
+	selected = uthread_select(sems, 3, &deadline);
+}
+
+static void select_first(void *arg)
+{
+	(void)arg;
+
+	if (uthread_select(sems, 3, NULL) == 0)
+		order[norder++] = 1;
+}
+
+static void down_first(void *arg)
+{
+	(void)arg;
+
+	sem_down(sems[0]);
+	order[norder++] = 2;
+}
+
+static bool spinning;
+
+static void spinner(void *arg)
+{
+	(void)arg;
+
+	while (spinning)
+		uthread_yield();
+}
+
+static void test_select(void *arg)
+{
+	struct timespec deadline;
+	double start;
+	int i, ret;
+	(void)arg;
+
+	TEST_ASSERT(uthread_select(NULL, 1, NULL) == -1);
+	TEST_ASSERT(uthread_select(sems, 0, NULL) == -1);
+
+	/* An available semaphore is taken right away */
+	sem_up(sems[1]);
+	TEST_ASSERT(uthread_select(sems, 3, NULL) == 1);
+
+	/* The first semaphore released wins */
+	uthread_create(selector, (void *)3);
+	uthread_yield();
+	sem_up(sems[2]);
+	uthread_yield();
+	TEST_ASSERT(selected == 2);
+
+	/* More semaphores than the registrations kept on the stack */
+	uthread_create(selector, (void *)NSEMS);
+	uthread_yield();
+	sem_up(sems[NSEMS - 3]);
+	uthread_yield();
+	TEST_ASSERT(selected == NSEMS - 3);
+
+	/* Selecting threads wait in line with the others */
+	uthread_create(select_first, NULL);
+	uthread_create(down_first, NULL);
+	uthread_yield();
+	sem_up(sems[0]);
+	sem_up(sems[0]);
+	uthread_yield();
+	TEST_ASSERT(norder == 2 && order[0] == 1 && order[1] == 2);
+
+	/* Deadlines, past and future, with no other thread */
+	deadline = in_ms(0);
+	TEST_ASSERT(uthread_select(sems, 3, &deadline) == 3);
+	deadline = in_ms(TIMEOUT_MS);
+	start = now_ms();
+	ret = uthread_select(sems, 3, &deadline);
+	TEST_ASSERT(ret == 3 && now_ms() - start >= TIMEOUT_MS);
+
+	/* Deadline while other threads keep the scheduler busy */
+	spinning = true;
+	uthread_create(spinner, NULL);
+	deadline = in_ms(TIMEOUT_MS);
+	start = now_ms();
+	ret = uthread_select(sems, 3, &deadline);
+	spinning = false;
+	TEST_ASSERT(ret == 3 && now_ms() - start >= TIMEOUT_MS);
+
+	/* A release before the deadline cancels it */
+	selected = -1;
+	start = now_ms();
+	uthread_create(timed_selector, NULL);
+	uthread_yield();
+	sem_up(sems[1]);
+	uthread_yield();
+	TEST_ASSERT(selected == 1 && now_ms() - start < 1000);
+
+	/* No registration was left behind */
+	for (i = 0; i < NSEMS; i++)
+		if (sem_destroy(sems[i]) == -1)
+			break;
+	TEST_ASSERT(i == NSEMS);
+}
+
+int main(void)
+{
+	int i, ret;
+
+	for (i = 0; i < NSEMS; i++)
+		sems[i] = sem_create(0);
+
+	ret = uthread_run(false, test_select, NULL);
+	TEST_ASSERT(ret == 0);
+	return 0;
+}
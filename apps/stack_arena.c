@@ -0,0 +1,119 @@
+/*
+ * Stack arena test
+ *
+ * More threads than the arena has slots are created, so that some of them get
+ * their stack from malloc(), and the arena can only be released once all of
+ * them have exited. A thread then overflows its stack in a child process, which
+ * must be killed by the guard page.
+ */
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <stack.h>
+#include <uthread.h>
+
+#define TEST_ASSERT(assert)				\
+do {									\
+	printf("ASSERT: " #assert " ... ");	\
+	if (assert) {						\
+		printf("PASS\n");				\
+	} else	{							\
+		printf("FAIL\n");				\
+		exit(1);						\
+	}									\
+} while(0)
+
+#define NSLOTS 4
+#define NTHREADS 16
+
+/* Recursion depth going past the end of a stack, but not of the arena */
+#define OVERFLOW_DEPTH 64
+
+static int ran;
+static int busy_release;
+
+static void worker(void *arg)
+{
+	(void)arg;
+
+	uthread_yield();
+	ran++;
+}
+
+static void spawner(void *arg)
+{
+	int i;
+	(void)arg;
+
+	for (i = 0; i < NTHREADS; i++)
+		uthread_create(worker, NULL);
+
+	/* Slots are in use, the arena cannot go away */
+	busy_release = uthread_stack_arena(0, 0, false);
+}
+
+static int overflow(int depth)
+{
+	volatile char buf[1024];
+
+	memset((char *)buf, depth, sizeof(buf));
+	if (depth == OVERFLOW_DEPTH)
+		return buf[0];
+	return overflow(depth + 1) + buf[0];
+}
+
+static void overflower(void *arg)
+{
+	(void)arg;
+
+	overflow(0);
+
+	/* Reached only if the overflow went unnoticed */
+	_exit(2);
+}
+
+static void overflow_spawner(void *arg)
+{
+	int i;
+	(void)arg;
+
+	/* Fill the lower slots, so that the overflowing stack has neighbours */
+	for (i = 0; i < NSLOTS - 2; i++)
+		uthread_create(worker, NULL);
+	uthread_create(overflower, NULL);
+}
+
+int main(void)
+{
+	pid_t pid;
+	int status;
+
+	TEST_ASSERT(uthread_stack_arena(NSLOTS, 0, true) == 0);
+	TEST_ASSERT(uthread_stack_arena(NSLOTS, 4096, true) == -1);
+
+	uthread_run(false, spawner, NULL);
+	TEST_ASSERT(ran == NTHREADS);
+	TEST_ASSERT(busy_release == -1);
+
+	/* Exited threads gave their slot back */
+	TEST_ASSERT(uthread_stack_arena(0, 0, false) == 0);
+
+	/* Overflowing a stack hits the guard page instead of its neighbour */
+	TEST_ASSERT(uthread_stack_arena(NSLOTS, 0, true) == 0);
+	fflush(stdout);
+	pid = fork();
+	if (pid == 0) {
+		uthread_run(false, overflow_spawner, NULL);
+		exit(0);
+	}
+	waitpid(pid, &status, 0);
+	TEST_ASSERT(WIFSIGNALED(status) && WTERMSIG(status) == SIGSEGV);
+
+	return 0;
+}
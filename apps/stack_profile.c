@@ -0,0 +1,119 @@
+/*
+ * Stack profiling test
+ *
+ * Threads with a shallow and a deep call chain are run with stack profiling
+ * enabled, and the measured high-water marks are read back from the dump. A
+ * second batch is then run with automatic stack sizing, which must give the
+ * shallow threads a smaller stack class than the deep ones.
+ */
+
+#define _GNU_SOURCE
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <stack.h>
+#include <uthread.h>
+
+#define TEST_ASSERT(assert)				\
+do {									\
+	printf("ASSERT: " #assert " ... ");	\
+	if (assert) {						\
+		printf("PASS\n");				\
+	} else	{							\
+		printf("FAIL\n");				\
+		exit(1);						\
+	}									\
+} while(0)
+
+#define NTHREADS 8
+
+/* Profile of an entry function, as read from the dump */
+struct profile {
+	unsigned long threads;
+	size_t max;
+	size_t size;
+};
+
+static volatile int sink;
+
+static void shallow(void *arg)
+{
+	(void)arg;
+
+	sink++;
+}
+
+static void deep(void *arg)
+{
+	volatile char buf[12000];
+
+	(void)arg;
+	memset((char *)buf, 0, sizeof(buf));
+	sink += buf[sizeof(buf) - 1];
+}
+
+static void spawner(void *arg)
+{
+	int i;
+	(void)arg;
+
+	for (i = 0; i < NTHREADS; i++) {
+		uthread_create(shallow, NULL);
+		uthread_create(deep, NULL);
+	}
+}
+
+/* Read the profile of @func from a dump, return -1 if it is not listed */
+static int read_profile(uthread_func_t func, struct profile *p)
+{
+	char *buf = NULL, *line, *save;
+	void *addr;
+	size_t len = 0;
+	FILE *f;
+	int ret = -1;
+
+	f = open_memstream(&buf, &len);
+	if (!f || uthread_stack_profile_dump(f))
+		return -1;
+	fclose(f);
+
+	/* Skip the header */
+	line = strtok_r(buf, "\n", &save);
+	while ((line = strtok_r(NULL, "\n", &save))) {
+		if (sscanf(line, "%p %lu %zu %zu", &addr, &p->threads, &p->max,
+			   &p->size) == 4 && addr == (void *)func) {
+			ret = 0;
+			break;
+		}
+	}
+	free(buf);
+	return ret;
+}
+
+int main(void)
+{
+	struct profile small, big;
+	int ret;
+
+	uthread_stack_profile(true);
+
+	ret = uthread_run(false, spawner, NULL);
+	TEST_ASSERT(ret == 0);
+	TEST_ASSERT(read_profile(shallow, &small) == 0);
+	TEST_ASSERT(read_profile(deep, &big) == 0);
+	TEST_ASSERT(small.threads == NTHREADS && big.threads == NTHREADS);
+	TEST_ASSERT(big.max > 12000);
+	TEST_ASSERT(small.max < big.max);
+
+	uthread_stack_autosize(true);
+	ret = uthread_run(false, spawner, NULL);
+	TEST_ASSERT(ret == 0);
+	TEST_ASSERT(read_profile(shallow, &small) == 0);
+	TEST_ASSERT(read_profile(deep, &big) == 0);
+	TEST_ASSERT(small.threads == 2 * NTHREADS);
+	TEST_ASSERT(small.size < big.size);
+
+	return 0;
+}
@@ -0,0 +1,141 @@
+/*
+ * Per-thread arena allocator test
+ *
+ * Allocations must be aligned and must not overlap, including large ones and
+ * across chunks, the chunks of an exited thread must be reused by the next one,
+ * and threads allocating with preemption enabled must not corrupt each other's
+ * allocations.
+ */
+
+#include <stdalign.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <alloc.h>
+#include <uthread.h>
+
+#define TEST_ASSERT(assert)				\
+do {									\
+	printf("ASSERT: " #assert " ... ");	\
+	if (assert) {						\
+		printf("PASS\n");				\
+	} else	{							\
+		printf("FAIL\n");				\
+		exit(1);						\
+	}									\
+} while(0)
+
+#define NALLOCS 10000
+#define NTHREADS 4
+#define NROUNDS 5000
+
+static unsigned char *ptrs[NALLOCS];
+static void *first;
+static bool overlap;
+static unsigned long corrupted;
+
+static bool aligned(void *p)
+{
+	return (uintptr_t)p % alignof(max_align_t) == 0;
+}
+
+static void allocator(void *arg)
+{
+	bool *ok = arg;
+	size_t i;
+
+	*ok = true;
+	for (i = 0; i < NALLOCS; i++) {
+		size_t size = 1 + i % 100;
+
+		ptrs[i] = uthread_arena_alloc(size);
+		if (!ptrs[i] || !aligned(ptrs[i]))
+			*ok = false;
+		else
+			memset(ptrs[i], i & 0xff, size);
+	}
+	for (i = 0; i < NALLOCS; i++)
+		if (ptrs[i][0] != (i & 0xff) || ptrs[i][i % 100] != (i & 0xff))
+			overlap = true;
+
+	first = ptrs[0];
+}
+
+static void second(void *arg)
+{
+	void **p = arg;
+
+	*p = uthread_arena_alloc(1);
+}
+
+static void large(void *arg)
+{
+	bool *ok = arg;
+	unsigned char *small = uthread_arena_alloc(8);
+	unsigned char *big = uthread_arena_alloc(1 << 20);
+	unsigned char *after = uthread_arena_alloc(8);
+
+	*ok = small && big && after && aligned(big) &&
+	      after == small + alignof(max_align_t);
+	if (big)
+		memset(big, 0xff, 1 << 20);
+}
+
+static void busy(void *arg)
+{
+	unsigned long tag = (uintptr_t)arg, r, i;
+	unsigned long *p[64];
+
+	/* Keep allocating long enough to be preempted halfway */
+	for (r = 0; r < NROUNDS; r++) {
+		for (i = 0; i < 64; i++) {
+			p[i] = uthread_arena_alloc(sizeof(unsigned long) * 4);
+			p[i][0] = p[i][3] = tag;
+		}
+		for (i = 0; i < 64; i++)
+			if (p[i][0] != tag || p[i][3] != tag)
+				corrupted++;
+		if (r % 64 == 0)
+			uthread_yield();
+	}
+}
+
+static void test_alloc(void *arg)
+{
+	bool ok = false, big_ok = false;
+	void *reused = NULL;
+	unsigned long i;
+	(void)arg;
+
+	uthread_create(allocator, &ok);
+	uthread_yield();
+	TEST_ASSERT(ok);
+	TEST_ASSERT(!overlap);
+
+	/* The chunk the first thread started with is handed to the next one */
+	uthread_create(second, &reused);
+	uthread_yield();
+	TEST_ASSERT(reused == first);
+
+	uthread_create(large, &big_ok);
+	uthread_yield();
+	TEST_ASSERT(big_ok);
+
+	for (i = 0; i < NTHREADS; i++)
+		uthread_create(busy, (void *)(uintptr_t)(i + 1));
+}
+
+int main(void)
+{
+	int ret;
+
+	TEST_ASSERT(uthread_arena_alloc(16) == NULL);
+	ret = uthread_run(true, test_alloc, NULL);
+	TEST_ASSERT(ret == 0);
+	TEST_ASSERT(corrupted == 0);
+	return 0;
+}
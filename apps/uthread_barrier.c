@@ -0,0 +1,103 @@
+/*
+ * Barrier and latch test
+ *
+ * Workers go through several phases separated by the same (cyclic) barrier,
+ * and check that nobody starts a phase before everybody finished the previous
+ * one. A latch then lets a thread wait for all the workers to be done.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <barrier.h>
+#include <uthread.h>
+
+#define TEST_ASSERT(assert)				\
+do {									\
+	printf("ASSERT: " #assert " ... ");	\
+	if (assert) {						\
+		printf("PASS\n");				\
+	} else	{							\
+		printf("FAIL\n");				\
+		exit(1);						\
+	}									\
+} while(0)
+
+#define NWORKERS 8
+#define NPHASES 5
+
+static uthread_barrier_t barrier;
+static uthread_latch_t latch;
+
+static int done[NPHASES];	/* Number of workers done with each phase */
+static int serial[NPHASES];	/* Number of last arrivers of each phase */
+static bool ordered = true;
+static int finished;
+
+static void worker(void *arg)
+{
+	int id = (int)(long)arg;
+	int phase, i;
+
+	for (phase = 0; phase < NPHASES; phase++) {
+		/* Everybody must be done with the previous phase */
+		if (phase > 0 && done[phase - 1] != NWORKERS)
+			ordered = false;
+
+		/* Workers do a different amount of work in each phase */
+		for (i = 0; i < (id + phase) % 3; i++)
+			uthread_yield();
+		done[phase]++;
+
+		if (uthread_barrier_wait(barrier) == 1)
+			serial[phase]++;
+	}
+
+	finished++;
+	uthread_latch_count_down(latch);
+}
+
+static void waiter(void *arg)
+{
+	(void)arg;
+
+	uthread_latch_wait(latch);
+	TEST_ASSERT(finished == NWORKERS);
+}
+
+static void main_thread(void *arg)
+{
+	long i;
+	int phase;
+	bool one_serial = true;
+	(void)arg;
+
+	uthread_create(waiter, NULL);
+	for (i = 0; i < NWORKERS; i++)
+		uthread_create(worker, (void *)i);
+
+	uthread_latch_wait(latch);
+	TEST_ASSERT(ordered);
+	for (phase = 0; phase < NPHASES; phase++)
+		if (serial[phase] != 1)
+			one_serial = false;
+	TEST_ASSERT(one_serial);
+
+	/* An open latch does not block, and cannot be counted down anymore */
+	TEST_ASSERT(uthread_latch_wait(latch) == 0);
+	TEST_ASSERT(uthread_latch_count_down(latch) == -1);
+}
+
+int main(void)
+{
+	TEST_ASSERT(uthread_barrier_create(0) == NULL);
+
+	barrier = uthread_barrier_create(NWORKERS);
+	latch = uthread_latch_create(NWORKERS);
+	uthread_run(false, main_thread, NULL);
+
+	TEST_ASSERT(uthread_barrier_destroy(barrier) == 0);
+	TEST_ASSERT(uthread_latch_destroy(latch) == 0);
+	return 0;
+}
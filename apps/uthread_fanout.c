@@ -0,0 +1,67 @@
+/*
+ * Lazy stack allocation test
+ *
+ * A thread creates many short-lived threads at once. Since their stacks are
+ * only allocated when they first run, and given back when they exit, they all
+ * share a couple of stacks instead of holding one each from their creation.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <uthread.h>
+
+#define TEST_ASSERT(assert)				\
+do {									\
+	printf("ASSERT: " #assert " ... ");	\
+	if (assert) {						\
+		printf("PASS\n");				\
+	} else	{							\
+		printf("FAIL\n");				\
+		exit(1);						\
+	}									\
+} while(0)
+
+#define NTHREADS 1000
+
+/* Stack addresses seen by the threads */
+static uintptr_t stacks[NTHREADS];
+static int nran;
+
+static void leaf(void *arg)
+{
+	int local;
+	(void)arg;
+
+	/* Stacks are at least a few KiB apart, round to a 1 KiB granule */
+	stacks[nran++] = (uintptr_t)&local >> 10;
+}
+
+static void fanout(void *arg)
+{
+	int i, j, distinct = 0;
+	(void)arg;
+
+	for (i = 0; i < NTHREADS; i++)
+		uthread_create(leaf, NULL);
+	while (nran < NTHREADS)
+		uthread_yield();
+
+	for (i = 0; i < NTHREADS; i++) {
+		for (j = 0; j < i && stacks[j] != stacks[i]; j++)
+			;
+		if (j == i)
+			distinct++;
+	}
+	TEST_ASSERT(distinct <= 2);
+}
+
+int main(void)
+{
+	uthread_run(false, fanout, NULL);
+	TEST_ASSERT(nran == NTHREADS);
+
+	return 0;
+}
@@ -0,0 +1,169 @@
+/*
+ * Future test
+ *
+ * Threads wait on futures set by other threads, directly or through the
+ * when_all and when_any combinators, and futures are destroyed at the various
+ * stages of their life.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <future.h>
+#include <uthread.h>
+
+#define TEST_ASSERT(assert)				\
+do {									\
+	printf("ASSERT: " #assert " ... ");	\
+	if (assert) {						\
+		printf("PASS\n");				\
+	} else	{							\
+		printf("FAIL\n");				\
+		exit(1);						\
+	}									\
+} while(0)
+
+#define NWAITERS 4
+#define NFUTURES 3
+
+static uthread_future_t future;
+static long got[NWAITERS], order[NWAITERS];
+static int norder;
+
+static void waiter(void *arg)
+{
+	long id = (long)arg;
+	void *value;
+
+	future_get(future, &value);
+	got[id] = (long)value;
+	order[norder++] = id;
+}
+
+static uthread_future_t inputs[NFUTURES];
+
+/* Set the input futures in reverse order, one per turn */
+static void setter(void *arg)
+{
+	int i;
+	(void)arg;
+
+	for (i = NFUTURES - 1; i >= 0; i--) {
+		uthread_yield();
+		promise_set(inputs[i], (void *)(long)(i * 10));
+	}
+}
+
+static void test_future(void)
+{
+	void *value;
+	long i;
+
+	future = future_create();
+	TEST_ASSERT(future_try_get(future, &value) == 1);
+	TEST_ASSERT(future_get(NULL, &value) == -1);
+	TEST_ASSERT(promise_set(NULL, NULL) == -1);
+
+	for (i = 0; i < NWAITERS; i++)
+		uthread_create(waiter, (void *)i);
+	uthread_yield();
+	TEST_ASSERT(promise_set(future, (void *)42) == 0);
+	TEST_ASSERT(promise_set(future, (void *)43) == -1);
+
+	/* The woken up threads still have to read the value */
+	TEST_ASSERT(future_destroy(future) == -1);
+	uthread_yield();
+	for (i = 0; i < NWAITERS; i++)
+		if (got[i] != 42 || order[i] != i)
+			break;
+	TEST_ASSERT(i == NWAITERS);
+	TEST_ASSERT(future_try_get(future, &value) == 0 && (long)value == 42);
+	TEST_ASSERT(future_get(future, &value) == 0 && (long)value == 42);
+	TEST_ASSERT(future_destroy(future) == 0);
+}
+
+static void test_combinators(void)
+{
+	uthread_future_t all, any;
+	void *value;
+	int i;
+
+	for (i = 0; i < NFUTURES; i++)
+		inputs[i] = future_create();
+
+	all = future_when_all(inputs, NFUTURES);
+	any = future_when_any(inputs, NFUTURES);
+	TEST_ASSERT(all && any);
+	TEST_ASSERT(future_when_any(inputs, 0) == NULL);
+
+	/* Inputs cannot go away while a combinator waits on them */
+	TEST_ASSERT(future_destroy(inputs[0]) == -1);
+
+	uthread_create(setter, NULL);
+	future_get(any, &value);
+	TEST_ASSERT((long)value == NFUTURES - 1);
+	TEST_ASSERT(future_try_get(all, &value) == 1);
+	future_get(all, &value);
+	TEST_ASSERT(future_try_get(inputs[0], &value) == 0 && value == NULL);
+	TEST_ASSERT(future_try_get(inputs[1], &value) == 0 && (long)value == 10);
+
+	TEST_ASSERT(future_destroy(all) == 0);
+	TEST_ASSERT(future_destroy(any) == 0);
+
+	/* Combinators of futures already set are set right away */
+	all = future_when_all(inputs, NFUTURES);
+	TEST_ASSERT(future_try_get(all, &value) == 0);
+	TEST_ASSERT(future_destroy(all) == 0);
+	any = future_when_any(inputs, NFUTURES);
+	TEST_ASSERT(future_try_get(any, &value) == 0 && value == 0);
+	TEST_ASSERT(future_destroy(any) == 0);
+	all = future_when_all(inputs, 0);
+	TEST_ASSERT(future_try_get(all, &value) == 0);
+	TEST_ASSERT(future_destroy(all) == 0);
+	TEST_ASSERT(future_when_all(NULL, 0) == NULL);
+
+	for (i = 0; i < NFUTURES; i++)
+		TEST_ASSERT(future_destroy(inputs[i]) == 0);
+}
+
+static void test_cancel(void)
+{
+	uthread_future_t input = future_create(), any, nested;
+	void *value;
+
+	/* Destroying a combinator unregisters it from its inputs */
+	any = future_when_any(&input, 1);
+	nested = future_when_all(&any, 1);
+	TEST_ASSERT(future_destroy(any) == -1);
+	TEST_ASSERT(future_destroy(nested) == 0);
+	TEST_ASSERT(future_destroy(any) == 0);
+	TEST_ASSERT(future_destroy(input) == 0);
+
+	/* Combinators can be nested */
+	input = future_create();
+	any = future_when_any(&input, 1);
+	nested = future_when_all(&any, 1);
+	promise_set(input, NULL);
+	TEST_ASSERT(future_try_get(nested, &value) == 0);
+	future_destroy(nested);
+	future_destroy(any);
+	future_destroy(input);
+}
+
+static void main_thread(void *arg)
+{
+	(void)arg;
+
+	test_future();
+	test_combinators();
+	test_cancel();
+}
+
+int main(void)
+{
+	int ret = uthread_run(false, main_thread, NULL);
+
+	TEST_ASSERT(ret == 0);
+	return 0;
+}
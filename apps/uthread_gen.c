@@ -0,0 +1,175 @@
+/*
+ * Direct transfer and generator test
+ *
+ * Two threads hand the CPU to each other with uthread_switch_to() while other
+ * threads are runnable, which must not get to run in the meantime. Generators
+ * are then consumed to completion, nested, and destroyed before and while
+ * running.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <gen.h>
+#include <uthread.h>
+
+#define TEST_ASSERT(assert)				\
+do {									\
+	printf("ASSERT: " #assert " ... ");	\
+	if (assert) {						\
+		printf("PASS\n");				\
+	} else	{							\
+		printf("FAIL\n");				\
+		exit(1);						\
+	}									\
+} while(0)
+
+#define NTRANSFERS 100
+
+static uthread_t first;
+static int turns[2 * NTRANSFERS];
+static int nturns;
+static int bystander_runs;
+
+static void bystander(void *arg)
+{
+	(void)arg;
+
+	bystander_runs++;
+}
+
+static void second(void *arg)
+{
+	int i;
+	(void)arg;
+
+	for (i = 0; i < NTRANSFERS; i++) {
+		turns[nturns++] = 2;
+		uthread_switch_to(first);
+	}
+	uthread_resume(first);
+}
+
+static void test_transfer(void)
+{
+	struct uthread_stats stats;
+	uthread_t partner;
+	bool alternated = true;
+	int i;
+
+	first = uthread_self();
+	partner = uthread_create_suspended(second, NULL);
+	TEST_ASSERT(partner != NULL);
+
+	/* Only suspended threads can be switched to */
+	TEST_ASSERT(uthread_switch_to(NULL) == -1);
+	TEST_ASSERT(uthread_switch_to(first) == -1);
+	TEST_ASSERT(uthread_resume(first) == -1);
+
+	uthread_create(bystander, NULL);
+	for (i = 0; i < NTRANSFERS; i++) {
+		turns[nturns++] = 1;
+		uthread_switch_to(partner);
+	}
+	TEST_ASSERT(bystander_runs == 0);
+	for (i = 0; i < nturns; i++)
+		if (turns[i] != 1 + i % 2)
+			alternated = false;
+	TEST_ASSERT(nturns == 2 * NTRANSFERS && alternated);
+	uthread_stats_get(&stats);
+	TEST_ASSERT(stats.transfers == 2 * NTRANSFERS);
+
+	/* The partner resumed this thread, then exits */
+	uthread_switch_to(partner);
+	uthread_yield();
+	TEST_ASSERT(bystander_runs == 1);
+}
+
+/* Generates the integers from 0 to the given limit */
+static void range(void *arg)
+{
+	long i, n = (long)arg;
+
+	for (i = 0; i < n; i++)
+		uthread_gen_yield((void *)i);
+}
+
+/* Generates the squares of the values of another generator */
+static void squares(void *arg)
+{
+	uthread_gen_t gen = arg;
+	void *value;
+
+	while (uthread_gen_next(gen, &value) == 0)
+		uthread_gen_yield((void *)((long)value * (long)value));
+	uthread_gen_destroy(gen);
+}
+
+static bool cleaned_up;
+
+static void forever(void *arg)
+{
+	long i = 0;
+	(void)arg;
+
+	while (uthread_gen_yield((void *)i++) == 0)
+		;
+	cleaned_up = true;
+}
+
+static void test_gen(void)
+{
+	uthread_gen_t gen;
+	void *value;
+	long sum = 0;
+	int ret;
+
+	TEST_ASSERT(uthread_gen_create(NULL, NULL) == NULL);
+	TEST_ASSERT(uthread_gen_yield(NULL) == -1);
+
+	gen = uthread_gen_create(range, (void *)10);
+	while ((ret = uthread_gen_next(gen, &value)) == 0)
+		sum += (long)value;
+	TEST_ASSERT(ret == 1 && sum == 45);
+	TEST_ASSERT(uthread_gen_next(gen, &value) == 1);
+	TEST_ASSERT(uthread_gen_destroy(gen) == 0);
+
+	gen = uthread_gen_create(squares, uthread_gen_create(range, (void *)5));
+	sum = 0;
+	while (uthread_gen_next(gen, &value) == 0)
+		sum += (long)value;
+	TEST_ASSERT(sum == 0 + 1 + 4 + 9 + 16);
+	TEST_ASSERT(uthread_gen_destroy(gen) == 0);
+
+	/* Destroying a generator lets it return */
+	gen = uthread_gen_create(forever, NULL);
+	uthread_gen_next(gen, &value);
+	uthread_gen_next(gen, &value);
+	TEST_ASSERT((long)value == 1);
+	TEST_ASSERT(uthread_gen_destroy(gen) == 0);
+	TEST_ASSERT(cleaned_up);
+
+	/* A generator never asked for a value never runs */
+	cleaned_up = false;
+	gen = uthread_gen_create(forever, NULL);
+	TEST_ASSERT(uthread_gen_destroy(gen) == 0);
+	TEST_ASSERT(!cleaned_up);
+}
+
+static void main_thread(void *arg)
+{
+	(void)arg;
+
+	test_transfer();
+	test_gen();
+}
+
+int main(void)
+{
+	int ret = uthread_run(false, main_thread, NULL);
+
+	TEST_ASSERT(ret == 0);
+	TEST_ASSERT(uthread_create_suspended(bystander, NULL) == NULL);
+	return 0;
+}
@@ -0,0 +1,153 @@
+/*
+ * I/O wrappers test
+ *
+ * Threads block reading from an empty pipe until another thread writes to it,
+ * including while a busy thread keeps the ready queue from ever being empty,
+ * and a client and a server thread exchange a message over a loopback TCP
+ * connection.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <io.h>
+#include <uthread.h>
+
+#define TEST_ASSERT(assert)				\
+do {									\
+	printf("ASSERT: " #assert " ... ");	\
+	if (assert) {						\
+		printf("PASS\n");				\
+	} else	{							\
+		printf("FAIL\n");				\
+		exit(1);						\
+	}									\
+} while(0)
+
+static int pipefd[2];
+static char got[8];
+static ssize_t got_len;
+static bool reading;
+static int busy_ret, busy_errno;
+
+static void reader(void *arg)
+{
+	(void)arg;
+
+	reading = true;
+	got_len = uthread_read(pipefd[0], got, sizeof(got));
+	reading = false;
+}
+
+/* Second reader of the same pipe, which cannot wait along with the first */
+static void second_reader(void *arg)
+{
+	(void)arg;
+
+	busy_ret = uthread_io_wait(pipefd[0], POLLIN);
+	busy_errno = errno;
+}
+
+static void spinner(void *arg)
+{
+	(void)arg;
+
+	while (reading)
+		uthread_yield();
+}
+
+static int listen_fd;
+static char echoed[8];
+
+static void server(void *arg)
+{
+	char buf[8];
+	ssize_t n;
+	int fd;
+	(void)arg;
+
+	fd = uthread_accept(listen_fd, NULL, NULL);
+	if (fd < 0)
+		return;
+	n = uthread_read(fd, buf, sizeof(buf));
+	if (n > 0)
+		uthread_write(fd, buf, n);
+	close(fd);
+}
+
+static void test_io(void *arg)
+{
+	struct sockaddr_in addr = { .sin_family = AF_INET };
+	socklen_t len = sizeof(addr);
+	FILE *tmp;
+	int fd;
+	(void)arg;
+
+	TEST_ASSERT(pipe2(pipefd, O_NONBLOCK) == 0);
+
+	/* The reader blocks until there is something to read */
+	uthread_create(reader, NULL);
+	uthread_yield();
+	TEST_ASSERT(reading);
+	uthread_create(second_reader, NULL);
+	uthread_yield();
+	TEST_ASSERT(busy_ret == -1 && busy_errno == EBUSY);
+	TEST_ASSERT(uthread_write(pipefd[1], "hello", 5) == 5);
+	while (reading)
+		uthread_yield();
+	TEST_ASSERT(got_len == 5 && !memcmp(got, "hello", 5));
+
+	/* Ready file descriptors are noticed while other threads keep running */
+	uthread_create(reader, NULL);
+	uthread_yield();
+	uthread_create(spinner, NULL);
+	TEST_ASSERT(uthread_write(pipefd[1], "busy", 4) == 4);
+	while (reading)
+		uthread_yield();
+	TEST_ASSERT(got_len == 4 && !memcmp(got, "busy", 4));
+
+	/* Regular files are always ready */
+	tmp = tmpfile();
+	TEST_ASSERT(uthread_io_wait(fileno(tmp), POLLIN) == 0);
+	fclose(tmp);
+	TEST_ASSERT(uthread_io_wait(pipefd[0], 0) == -1);
+	TEST_ASSERT(uthread_io_wait(-1, POLLIN) == -1);
+
+	/* Loopback connection */
+	listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	TEST_ASSERT(bind(listen_fd, (struct sockaddr *)&addr, len) == 0);
+	TEST_ASSERT(listen(listen_fd, 1) == 0);
+	getsockname(listen_fd, (struct sockaddr *)&addr, &len);
+	uthread_create(server, NULL);
+
+	fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	TEST_ASSERT(uthread_connect(fd, (struct sockaddr *)&addr, len) == 0);
+	TEST_ASSERT(uthread_write(fd, "echo", 4) == 4);
+	TEST_ASSERT(uthread_read(fd, echoed, sizeof(echoed)) == 4);
+	TEST_ASSERT(!memcmp(echoed, "echo", 4));
+	TEST_ASSERT(uthread_read(fd, echoed, sizeof(echoed)) == 0);
+
+	close(fd);
+	close(listen_fd);
+	close(pipefd[0]);
+	close(pipefd[1]);
+}
+
+int main(void)
+{
+	int ret;
+
+	ret = uthread_run(false, test_io, NULL);
+	TEST_ASSERT(ret == 0);
+	return 0;
+}
@@ -0,0 +1,101 @@
+/*
+ * Preemption latency profiling test
+ *
+ * Busy threads, which also take a semaphore now and then, run with preemption
+ * enabled while profiling. The dump must then show preemption delays, and
+ * masked regions for at least one call site of preempt_disable().
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <latency.h>
+#include <sem.h>
+#include <uthread.h>
+
+#define TEST_ASSERT(assert)				\
+do {									\
+	printf("ASSERT: " #assert " ... ");	\
+	if (assert) {						\
+		printf("PASS\n");				\
+	} else	{							\
+		printf("FAIL\n");				\
+		exit(1);						\
+	}									\
+} while(0)
+
+#define NTHREADS 3
+
+/* CPU time each busy thread burns, in nanoseconds */
+#define BUSY_NS 60000000LL
+
+static sem_t sem;
+
+static long long cpu_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void busy(void *arg)
+{
+	long long until = cpu_ns() + BUSY_NS;
+	unsigned long i = 0;
+	(void)arg;
+
+	while (cpu_ns() < until) {
+		if (++i % 1000 == 0) {
+			sem_down(sem);
+			sem_up(sem);
+		}
+	}
+}
+
+static void spawner(void *arg)
+{
+	int i;
+	(void)arg;
+
+	for (i = 0; i < NTHREADS; i++)
+		uthread_create(busy, NULL);
+}
+
+int main(void)
+{
+	unsigned long delays = 0, sites = 0;
+	char *buf = NULL, *line, *save;
+	size_t len = 0;
+	FILE *f;
+	int ret;
+
+	TEST_ASSERT(uthread_latency_dump(NULL) == -1);
+	TEST_ASSERT(uthread_latency_start() == 0);
+
+	sem = sem_create(1);
+	ret = uthread_run(true, spawner, NULL);
+	TEST_ASSERT(ret == 0);
+	uthread_latency_stop();
+	sem_destroy(sem);
+
+	f = open_memstream(&buf, &len);
+	TEST_ASSERT(uthread_latency_dump(f) == 0);
+	fclose(f);
+
+	/* Skip the header, then read the delays and count the sites */
+	line = strtok_r(buf, "\n", &save);
+	line = strtok_r(NULL, "\n", &save);
+	if (line)
+		sscanf(line, "preemption delay %lu", &delays);
+	while (strtok_r(NULL, "\n", &save))
+		sites++;
+	free(buf);
+
+	TEST_ASSERT(delays > 0);
+	TEST_ASSERT(sites > 0);
+	return 0;
+}
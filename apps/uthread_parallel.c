@@ -0,0 +1,158 @@
+/*
+ * Parallel loop and fork-join test
+ *
+ * A parallel loop must process every index of its range exactly once, in
+ * subranges no larger than its grain, while letting the other ready threads
+ * run, and must hand part of its range over to another thread when nothing
+ * else is ready. Fork-join is checked by computing Fibonacci numbers with one
+ * spawned child per call.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <parallel.h>
+#include <uthread.h>
+
+#define TEST_ASSERT(assert)				\
+do {									\
+	printf("ASSERT: " #assert " ... ");	\
+	if (assert) {						\
+		printf("PASS\n");				\
+	} else	{							\
+		printf("FAIL\n");				\
+		exit(1);						\
+	}									\
+} while(0)
+
+#define N 1000
+#define GRAIN 7
+
+static int hits[N];
+static size_t max_range;
+static uthread_t runners[2];
+static bool split;
+static bool spinning;
+static unsigned long spins;
+
+static void body(size_t begin, size_t end, void *arg)
+{
+	size_t i;
+	(void)arg;
+
+	if (end - begin > max_range)
+		max_range = end - begin;
+	for (i = begin; i < end; i++)
+		hits[i]++;
+
+	if (!runners[0])
+		runners[0] = uthread_self();
+	else if (runners[0] != uthread_self())
+		split = true;
+}
+
+static bool all_hit_once(void)
+{
+	int i;
+
+	for (i = 0; i < N; i++)
+		if (hits[i] != 1)
+			return false;
+	return true;
+}
+
+static void spinner(void *arg)
+{
+	(void)arg;
+
+	while (spinning) {
+		spins++;
+		uthread_yield();
+	}
+}
+
+struct fib {
+	unsigned int n;
+	unsigned long result;
+};
+
+static void fib(void *arg)
+{
+	struct fib *f = arg;
+	struct uthread_group group = UTHREAD_GROUP_INIT;
+	struct fib a, b;
+
+	if (f->n < 2) {
+		f->result = f->n;
+		return;
+	}
+
+	a.n = f->n - 1;
+	b.n = f->n - 2;
+	uthread_spawn(&group, fib, &a);
+	fib(&b);
+	uthread_sync(&group);
+	f->result = a.result + b.result;
+}
+
+static void nop(void *arg)
+{
+	(void)arg;
+}
+
+static void test_parallel(void *arg)
+{
+	struct uthread_group group = UTHREAD_GROUP_INIT;
+	struct fib f = { 15, 0 };
+	int i;
+	(void)arg;
+
+	/* Alone, the loop hands part of the range over to another thread */
+	TEST_ASSERT(uthread_parallel_for(0, N, GRAIN, body, NULL) == 0);
+	TEST_ASSERT(all_hit_once());
+	TEST_ASSERT(max_range <= GRAIN);
+	TEST_ASSERT(split);
+
+	/* With another thread ready, both take turns */
+	for (i = 0; i < N; i++)
+		hits[i] = 0;
+	spinning = true;
+	uthread_create(spinner, NULL);
+	uthread_yield();
+	spins = 0;
+	TEST_ASSERT(uthread_parallel_for(0, N, GRAIN, body, NULL) == 0);
+	TEST_ASSERT(all_hit_once());
+	TEST_ASSERT(spins >= N / GRAIN - 1);
+	spinning = false;
+
+	/* Empty ranges and a grain of 0 */
+	for (i = 0; i < N; i++)
+		hits[i] = 0;
+	max_range = 0;
+	TEST_ASSERT(uthread_parallel_for(N, 0, GRAIN, body, NULL) == 0);
+	TEST_ASSERT(uthread_parallel_for(0, N, 0, body, NULL) == 0);
+	TEST_ASSERT(all_hit_once());
+	TEST_ASSERT(max_range == 1);
+	TEST_ASSERT(uthread_parallel_for(0, N, GRAIN, NULL, NULL) == -1);
+
+	/* Fork-join */
+	fib(&f);
+	TEST_ASSERT(f.result == 610);
+	TEST_ASSERT(uthread_sync(&group) == 0);
+	TEST_ASSERT(uthread_spawn(&group, nop, NULL) == 0);
+	TEST_ASSERT(uthread_spawn(&group, nop, NULL) == 0);
+	TEST_ASSERT(uthread_sync(&group) == 0);
+	TEST_ASSERT(uthread_spawn(NULL, nop, NULL) == -1);
+	TEST_ASSERT(uthread_spawn(&group, NULL, NULL) == -1);
+	TEST_ASSERT(uthread_sync(NULL) == -1);
+}
+
+int main(void)
+{
+	int ret;
+
+	ret = uthread_run(false, test_parallel, NULL);
+	TEST_ASSERT(ret == 0);
+	return 0;
+}
@@ -0,0 +1,140 @@
+/*
+ * Worker pool test
+ *
+ * Jobs are submitted one by one and in batches larger than the queue of the
+ * pool, some of them blocking on a semaphore, and every job must be run exactly
+ * once by the time the pool is idle.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <pool.h>
+#include <sem.h>
+#include <uthread.h>
+
+#define TEST_ASSERT(assert)				\
+do {									\
+	printf("ASSERT: " #assert " ... ");	\
+	if (assert) {						\
+		printf("PASS\n");				\
+	} else	{							\
+		printf("FAIL\n");				\
+		exit(1);						\
+	}									\
+} while(0)
+
+#define NWORKERS 4
+#define CAPACITY 8
+#define NJOBS 100
+
+static int runs[NJOBS];
+static int running, max_running;
+static sem_t gate;
+
+static void job(void *arg)
+{
+	runs[(long)arg]++;
+}
+
+/* Job blocking until the gate opens, to check how many run at once */
+static void gated_job(void *arg)
+{
+	if (++running > max_running)
+		max_running = running;
+	sem_down(gate);
+	running--;
+	runs[(long)arg]++;
+}
+
+static bool all_ran_once(void)
+{
+	int i;
+
+	for (i = 0; i < NJOBS; i++)
+		if (runs[i] != 1)
+			return false;
+	return true;
+}
+
+/* Open the gate once all the workers are stuck on it */
+static void releaser(void *arg)
+{
+	(void)arg;
+
+	while (running < NWORKERS)
+		uthread_yield();
+	sem_up_n(gate, NJOBS);
+}
+
+static void test_pool(void *arg)
+{
+	struct uthread_pool_job jobs[NJOBS];
+	uthread_pool_t pool;
+	long i;
+	(void)arg;
+
+	TEST_ASSERT(pool_create(0, CAPACITY) == NULL);
+	TEST_ASSERT(pool_create(NWORKERS, 0) == NULL);
+
+	pool = pool_create(NWORKERS, CAPACITY);
+	TEST_ASSERT(pool != NULL);
+	TEST_ASSERT(pool_submit(pool, NULL, NULL) == -1);
+	TEST_ASSERT(pool_submit(NULL, job, NULL) == -1);
+
+	/* Idle pools do not block */
+	TEST_ASSERT(pool_wait_idle(pool) == 0);
+
+	/* One by one, more jobs than fit in the queue */
+	for (i = 0; i < NJOBS; i++)
+		pool_submit(pool, job, (void *)i);
+	pool_wait_idle(pool);
+	TEST_ASSERT(all_ran_once());
+
+	/* A batch larger than the queue */
+	for (i = 0; i < NJOBS; i++) {
+		runs[i] = 0;
+		jobs[i].func = job;
+		jobs[i].arg = (void *)i;
+	}
+	TEST_ASSERT(pool_submit_batch(pool, jobs, NJOBS) == 0);
+	pool_wait_idle(pool);
+	TEST_ASSERT(all_ran_once());
+
+	/* Invalid batches are rejected as a whole */
+	jobs[NJOBS / 2].func = NULL;
+	TEST_ASSERT(pool_submit_batch(pool, jobs, NJOBS) == -1);
+	TEST_ASSERT(pool_wait_idle(pool) == 0);
+
+	/* Blocking jobs only occupy the workers */
+	for (i = 0; i < NJOBS; i++) {
+		runs[i] = 0;
+		jobs[i].func = gated_job;
+	}
+	uthread_create(releaser, NULL);
+	pool_submit_batch(pool, jobs, NJOBS);
+	pool_wait_idle(pool);
+	TEST_ASSERT(all_ran_once());
+	TEST_ASSERT(max_running == NWORKERS);
+
+	/* Destroying waits for the pending jobs */
+	for (i = 0; i < NJOBS; i++) {
+		runs[i] = 0;
+		pool_submit(pool, job, (void *)i);
+	}
+	TEST_ASSERT(pool_destroy(pool) == 0);
+	TEST_ASSERT(all_ran_once());
+}
+
+int main(void)
+{
+	int ret;
+
+	gate = sem_create(0);
+	ret = uthread_run(false, test_pool, NULL);
+	TEST_ASSERT(ret == 0);
+	TEST_ASSERT(pool_create(NWORKERS, CAPACITY) == NULL);
+	TEST_ASSERT(sem_destroy(gate) == 0);
+	return 0;
+}
@@ -0,0 +1,229 @@
+/*
+ * Scheduler policy test
+ *
+ * Runs the same kind of workload under each policy shipped with the library,
+ * and checks the order in which threads run, as well as the starvation
+ * protection of the run next slot. A custom policy, built on top of
+ * the round-robin one, checks that the library calls the optional hooks.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sem.h>
+#include <uthread.h>
+#include <uthread_sched.h>
+
+#define TEST_ASSERT(assert)				\
+do {									\
+	printf("ASSERT: " #assert " ... ");	\
+	if (assert) {						\
+		printf("PASS\n");				\
+	} else	{							\
+		printf("FAIL\n");				\
+		exit(1);						\
+	}									\
+} while(0)
+
+static char order[32];
+static size_t norder;
+
+/* Record the letter of the thread twice, yielding in between */
+static void letter(void *arg)
+{
+	order[norder++] = (char)(long)arg;
+	uthread_yield();
+	order[norder++] = (char)(long)arg;
+}
+
+static void three_letters(void *arg)
+{
+	(void)arg;
+
+	uthread_create(letter, (void *)'A');
+	uthread_create(letter, (void *)'B');
+	uthread_create(letter, (void *)'C');
+}
+
+static void priorities(void *arg)
+{
+	(void)arg;
+
+	/* Threads only get their priority once handed to the policy again */
+	uthread_set_priority(uthread_self(), UTHREAD_SCHED_PRIO_MAX);
+	uthread_yield();
+
+	uthread_set_priority(uthread_self(), 2);
+	uthread_create(letter, (void *)'L');
+	uthread_set_priority(uthread_self(), 6);
+	uthread_create(letter, (void *)'H');
+	uthread_set_priority(uthread_self(), 4);
+	uthread_create(letter, (void *)'M');
+}
+
+static void test_order(const struct uthread_sched_ops *ops,
+		       uthread_func_t func, const char *expected)
+{
+	memset(order, 0, sizeof(order));
+	norder = 0;
+	TEST_ASSERT(uthread_run_policy(false, ops, func, NULL) == 0);
+	printf("%s: %s\n", ops ? ops->name : "default", order);
+	TEST_ASSERT(strcmp(order, expected) == 0);
+}
+
+/*
+ * Two threads waking each other up, and a bystander woken up by neither, which
+ * must not wait for them to be done
+ */
+#define NROUNDS 1000
+
+static sem_t ping, pong;
+static int rounds, bystander_round = -1;
+
+static void bystander(void *arg)
+{
+	(void)arg;
+
+	bystander_round = rounds;
+}
+
+static void ponger(void *arg)
+{
+	int i;
+	(void)arg;
+
+	for (i = 0; i < NROUNDS; i++) {
+		sem_down(ping);
+		sem_up(pong);
+	}
+}
+
+static void pinger(void *arg)
+{
+	(void)arg;
+
+	for (rounds = 0; rounds < NROUNDS; rounds++) {
+		if (rounds == 1)
+			uthread_create(bystander, NULL);
+		sem_up(ping);
+		sem_down(pong);
+	}
+}
+
+static void chain(void *arg)
+{
+	(void)arg;
+
+	uthread_create(pinger, NULL);
+	uthread_create(ponger, NULL);
+}
+
+/* Policy counting the hooks it gets called with, on top of round-robin */
+static int nblock, nwake, ninit, nfini;
+
+static int count_init(void)
+{
+	ninit++;
+	return uthread_sched_rr.init();
+}
+
+static void count_fini(void)
+{
+	nfini++;
+	uthread_sched_rr.fini();
+}
+
+static void count_block(uthread_t uthread)
+{
+	(void)uthread;
+	nblock++;
+}
+
+static void count_wake(uthread_t uthread)
+{
+	(void)uthread;
+	nwake++;
+}
+
+static struct uthread_sched_ops count_ops = {
+	.name = "count",
+	.init = count_init,
+	.fini = count_fini,
+	.on_block = count_block,
+	.on_wake = count_wake,
+};
+
+static sem_t sem;
+
+static void sleeper(void *arg)
+{
+	(void)arg;
+
+	sem_down(sem);
+}
+
+static void hooks(void *arg)
+{
+	int i;
+	(void)arg;
+
+	for (i = 0; i < 4; i++)
+		uthread_create(sleeper, NULL);
+	uthread_yield();
+	for (i = 0; i < 4; i++)
+		sem_up(sem);
+}
+
+static void self(void *arg)
+{
+	uthread_t me = uthread_self();
+	(void)arg;
+
+	TEST_ASSERT(me != NULL);
+	TEST_ASSERT(uthread_get_priority(me) == 0);
+	TEST_ASSERT(uthread_set_priority(me, -32768) == 0);
+	TEST_ASSERT(uthread_get_priority(me) == -32768);
+	TEST_ASSERT(uthread_set_priority(me, 32768) == -1);
+	TEST_ASSERT(uthread_set_priority(NULL, 1) == -1);
+}
+
+int main(void)
+{
+	struct uthread_sched_ops broken = { .name = "broken" };
+	int ret;
+
+	TEST_ASSERT(uthread_self() == NULL);
+	ret = uthread_run(false, self, NULL);
+	TEST_ASSERT(ret == 0);
+
+	test_order(NULL, three_letters, "ABCABC");
+	test_order(&uthread_sched_rr, three_letters, "ABCABC");
+	test_order(&uthread_sched_runnext, three_letters, "CABCAB");
+	test_order(&uthread_sched_lifo, three_letters, "CBACBA");
+	test_order(&uthread_sched_prio, priorities, "HHMMLL");
+
+	/* The run next slot can only be used a bounded number of times in a row */
+	ping = sem_create(0);
+	pong = sem_create(0);
+	TEST_ASSERT(uthread_run_policy(false, &uthread_sched_runnext, chain,
+				       NULL) == 0);
+	printf("bystander ran in round %d\n", bystander_round);
+	TEST_ASSERT(bystander_round >= 1 && bystander_round < NROUNDS / 10);
+	sem_destroy(ping);
+	sem_destroy(pong);
+
+	/* A policy must at least be able to enqueue and pick items */
+	TEST_ASSERT(uthread_run_policy(false, &broken, three_letters, NULL) == -1);
+
+	count_ops.enqueue = uthread_sched_rr.enqueue;
+	count_ops.pick_next = uthread_sched_rr.pick_next;
+	sem = sem_create(0);
+	TEST_ASSERT(uthread_run_policy(false, &count_ops, hooks, NULL) == 0);
+	TEST_ASSERT(ninit == 1 && nfini == 1);
+	TEST_ASSERT(nblock == 4 && nwake == 4);
+	sem_destroy(sem);
+
+	return 0;
+}
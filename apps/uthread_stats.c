@@ -0,0 +1,81 @@
+/*
+ * Scheduler statistics test
+ *
+ * Two threads yield to each other a fixed number of times, and one of them
+ * blocks once on a semaphore. The counters reported by the library are then
+ * checked against what the threads did, and per-thread statistics must not be
+ * available outside of uthread_run().
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <sem.h>
+#include <uthread.h>
+
+#define TEST_ASSERT(assert)				\
+do {									\
+	printf("ASSERT: " #assert " ... ");	\
+	if (assert) {						\
+		printf("PASS\n");				\
+	} else	{							\
+		printf("FAIL\n");				\
+		exit(1);						\
+	}									\
+} while(0)
+
+#define NYIELDS 10
+
+static sem_t sem;
+
+static void thread2(void *arg)
+{
+	int i;
+	(void)arg;
+
+	for (i = 0; i < NYIELDS; i++)
+		uthread_yield();
+	sem_up(sem);
+}
+
+static void thread1(void *arg)
+{
+	struct uthread_thread_stats ts;
+	int i;
+	(void)arg;
+
+	uthread_create(thread2, NULL);
+	for (i = 0; i < NYIELDS; i++)
+		uthread_yield();
+	sem_down(sem);
+
+	uthread_thread_stats_get(&ts);
+	TEST_ASSERT(ts.id == 1);
+	TEST_ASSERT(ts.voluntary_yields == NYIELDS);
+	TEST_ASSERT(ts.preemptive_yields == 0);
+	TEST_ASSERT(ts.blocks == 1 && ts.unblocks == 1);
+	TEST_ASSERT(ts.run_ns > 0);
+}
+
+int main(void)
+{
+	struct uthread_stats s;
+	struct uthread_thread_stats ts;
+
+	TEST_ASSERT(uthread_thread_stats_get(&ts) == -1);
+	sem = sem_create(0);
+	uthread_run(false, thread1, NULL);
+	sem_destroy(sem);
+
+	uthread_stats_get(&s);
+	TEST_ASSERT(s.threads_created == 2);
+	TEST_ASSERT(s.threads_exited == 2);
+	TEST_ASSERT(s.voluntary_yields == 2 * NYIELDS);
+	TEST_ASSERT(s.blocks == 1 && s.unblocks == 1);
+	TEST_ASSERT(s.blocked_hwm == 1);
+	TEST_ASSERT(s.context_switches >= 2 * NYIELDS);
+	TEST_ASSERT(uthread_thread_stats_get(&ts) == -1);
+
+	return 0;
+}
@@ -0,0 +1,114 @@
+/*
+ * Stackless task test
+ *
+ * Tasks are spawned between threads, and must run in FIFO order with them.
+ * Tasks also create threads, spawn other tasks and release a semaphore on
+ * which a thread is blocked.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sem.h>
+#include <uthread.h>
+
+#define TEST_ASSERT(assert)				\
+do {									\
+	printf("ASSERT: " #assert " ... ");	\
+	if (assert) {						\
+		printf("PASS\n");				\
+	} else	{							\
+		printf("FAIL\n");				\
+		exit(1);						\
+	}									\
+} while(0)
+
+static char order[16];
+static size_t norder;
+static sem_t sem;
+
+static void log_run(void *arg)
+{
+	order[norder++] = *(char *)arg;
+}
+
+static void thread_b(void *arg)
+{
+	log_run(arg);
+}
+
+static void task_d(void *arg)
+{
+	log_run(arg);
+
+	/* Tasks never yield */
+	uthread_yield();
+	log_run("d");
+}
+
+static void task_c(void *arg)
+{
+	log_run(arg);
+	uthread_spawn_task(task_d, "D");
+	uthread_create(thread_b, "E");
+}
+
+static void task_up(void *arg)
+{
+	(void)arg;
+
+	sem_up(sem);
+}
+
+static void thread_waiter(void *arg)
+{
+	(void)arg;
+
+	sem_down(sem);
+	log_run("W");
+}
+
+static void thread1(void *arg)
+{
+	struct uthread_stats stats;
+	(void)arg;
+
+	/* Tasks and threads run in the order they were queued */
+	uthread_spawn_task(log_run, "A");
+	uthread_create(thread_b, "B");
+	uthread_spawn_task(task_c, "C");
+	uthread_yield();
+	log_run("1");
+	uthread_yield();
+	uthread_yield();
+	order[norder] = '\0';
+	TEST_ASSERT(strcmp(order, "ABC1DdE") == 0);
+
+	/* A task can wake up a blocked thread */
+	norder = 0;
+	uthread_create(thread_waiter, NULL);
+	uthread_yield();
+	uthread_spawn_task(task_up, NULL);
+	uthread_yield();
+	uthread_yield();
+	order[norder] = '\0';
+	TEST_ASSERT(strcmp(order, "W") == 0);
+
+	uthread_stats_get(&stats);
+	TEST_ASSERT(stats.tasks_run == 4);
+}
+
+int main(void)
+{
+	sem = sem_create(0);
+
+	/* Tasks can only be spawned while the library runs */
+	TEST_ASSERT(uthread_spawn_task(log_run, "X") == -1);
+
+	uthread_run(false, thread1, NULL);
+
+	sem_destroy(sem);
+	return 0;
+}
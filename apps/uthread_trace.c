@@ -0,0 +1,153 @@
+/*
+ * Scheduling trace test
+ *
+ * Two threads hand a semaphore back and forth while a third one spins until
+ * it gets preempted. The scheduling events are recorded and exported in the
+ * Chrome trace-event format, which must then hold the expected events, context
+ * switches showing as "run" slices, with instants in time order. If a file is
+ * given as argument, the trace is also written to it, to be loaded in
+ * chrome://tracing or Perfetto.
+ */
+
+#define _GNU_SOURCE
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sem.h>
+#include <trace.h>
+#include <uthread.h>
+
+#define TEST_ASSERT(assert)				\
+do {									\
+	printf("ASSERT: " #assert " ... ");	\
+	if (assert) {						\
+		printf("PASS\n");				\
+	} else	{							\
+		printf("FAIL\n");				\
+		exit(1);						\
+	}									\
+} while(0)
+
+#define NROUNDS 100
+
+static sem_t ping, pong;
+static volatile bool done;
+
+static void spinner(void *arg)
+{
+	(void)arg;
+
+	while (!done)
+		;
+}
+
+static void ponger(void *arg)
+{
+	int i;
+	(void)arg;
+
+	for (i = 0; i < NROUNDS; i++) {
+		sem_down(ping);
+		sem_up(pong);
+	}
+}
+
+static void pinger(void *arg)
+{
+	int i;
+	(void)arg;
+
+	uthread_create(ponger, NULL);
+	uthread_create(spinner, NULL);
+	for (i = 0; i < NROUNDS; i++) {
+		sem_up(ping);
+		sem_down(pong);
+	}
+	done = true;
+}
+
+/* Number of events named @name in @json */
+static unsigned long count_events(const char *json, const char *name)
+{
+	char key[64];
+	const char *p = json;
+	unsigned long n = 0;
+
+	snprintf(key, sizeof(key), "\"name\":\"%s\"", name);
+	while ((p = strstr(p, key))) {
+		p += strlen(key);
+		n++;
+	}
+	return n;
+}
+
+/* Whether the instant events of @json have non-decreasing timestamps */
+static bool instants_ordered(const char *json)
+{
+	const char *p = json;
+	double last = 0;
+
+	while ((p = strstr(p, "\"ph\":\"i\""))) {
+		const char *ts = strstr(p, "\"ts\":");
+		double t;
+
+		if (!ts)
+			return false;
+		t = strtod(ts + 5, NULL);
+		if (t < last)
+			return false;
+		last = t;
+		p = ts;
+	}
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	char *buf = NULL;
+	size_t len = 0;
+	FILE *f;
+	int ret;
+
+	if (uthread_trace_start(4096)) {
+		fprintf(stderr, "libuthread was built without tracing support\n");
+		return 0;
+	}
+
+	ping = sem_create(0);
+	pong = sem_create(0);
+	ret = uthread_run(true, pinger, NULL);
+	TEST_ASSERT(ret == 0);
+	uthread_trace_stop();
+
+	f = open_memstream(&buf, &len);
+	TEST_ASSERT(uthread_trace_dump(f) == 0);
+	fclose(f);
+
+	TEST_ASSERT(count_events(buf, "run") > 0);
+	TEST_ASSERT(count_events(buf, "block") >= NROUNDS);
+	TEST_ASSERT(count_events(buf, "unblock") >= NROUNDS);
+	TEST_ASSERT(count_events(buf, "sem_down") >= 2 * NROUNDS);
+	TEST_ASSERT(count_events(buf, "sem_up") >= 2 * NROUNDS);
+	TEST_ASSERT(count_events(buf, "exit") == 3);
+	TEST_ASSERT(instants_ordered(buf));
+
+	if (argc > 1) {
+		f = fopen(argv[1], "w");
+		if (!f) {
+			perror("fopen");
+			return 1;
+		}
+		uthread_trace_dump(f);
+		fclose(f);
+		printf("Trace written to %s\n", argv[1]);
+	}
+
+	free(buf);
+	uthread_trace_release();
+	sem_destroy(ping);
+	sem_destroy(pong);
+	return 0;
+}
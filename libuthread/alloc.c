@@ -0,0 +1,113 @@
+#include <stdalign.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "alloc.h"
+#include "private.h"
+
+/* Size of a chunk, header included */
+#define ALLOC_CHUNK_SIZE 16384
+
+/* Number of released chunks kept for later threads */
+#define ALLOC_CACHE_SIZE 64
+
+/* Alignment of the allocations */
+#define ALLOC_ALIGN alignof(max_align_t)
+
+/* Chunk of an arena, followed by the memory handed out */
+struct alloc_chunk {
+    struct alloc_chunk *next;       // Next chunk of the arena, or of the cache
+    size_t size;                    // Size of the chunk, header included
+    alignas(max_align_t) char data[];
+};
+
+/* Released chunks of the default size, ready to be reused */
+static struct alloc_chunk *cache;
+static size_t cache_size;
+
+/*
+ * Give @arena a new chunk with room for @size bytes. Requests larger than a
+ * quarter of a chunk get a chunk of their own, so that they do not waste the
+ * rest of the current one.
+ */
+static void *alloc_slow(struct uthread_alloc_arena *arena, size_t size)
+{
+    struct alloc_chunk *chunk;
+    size_t chunk_size = ALLOC_CHUNK_SIZE;
+    bool dedicated = size > (ALLOC_CHUNK_SIZE - sizeof(*chunk)) / 4;
+
+    if (dedicated) {
+        chunk_size = sizeof(*chunk) + size;
+    }
+
+    preempt_disable();
+    if (!dedicated && cache) {
+        chunk = cache;
+        cache = chunk->next;
+        cache_size--;
+    } else {
+        chunk = malloc(chunk_size);
+        if (!chunk) {
+            preempt_enable();
+            return NULL;
+        }
+        chunk->size = chunk_size;
+    }
+
+    if (dedicated && arena->chunks) {
+        // Keep bumping within the current chunk
+        chunk->next = arena->chunks->next;
+        arena->chunks->next = chunk;
+    } else {
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+        arena->next = chunk->data + size;
+        arena->end = (char *)chunk + chunk->size;
+    }
+    preempt_enable();
+    return chunk->data;
+}
+
+void *uthread_arena_alloc(size_t size)
+{
+    struct uthread_alloc_arena *arena = uthread_current_arena();
+    char *ptr;
+
+    if (!arena || size > SIZE_MAX - ALLOC_CHUNK_SIZE) {
+        return NULL;
+    }
+
+    // Round up so that the next allocation stays aligned
+    size = size ? (size + ALLOC_ALIGN - 1) & ~(ALLOC_ALIGN - 1) : ALLOC_ALIGN;
+
+    // Only the current thread uses its arena, even if preempted halfway
+    ptr = arena->next;
+    if (size <= (size_t)(arena->end - ptr)) {
+        arena->next = ptr + size;
+        return ptr;
+    }
+    return alloc_slow(arena, size);
+}
+
+void uthread_alloc_release(struct uthread_alloc_arena *arena)
+{
+    struct alloc_chunk *chunk = arena->chunks, *next;
+
+    for (; chunk; chunk = next) {
+        next = chunk->next;
+        if (chunk->size == ALLOC_CHUNK_SIZE &&
+            cache_size < ALLOC_CACHE_SIZE) {
+            chunk->next = cache;
+            cache = chunk;
+            cache_size++;
+        } else {
+            free(chunk);
+        }
+    }
+
+    arena->next = NULL;
+    arena->end = NULL;
+    arena->chunks = NULL;
+}
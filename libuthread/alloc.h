@@ -0,0 +1,30 @@
+#ifndef _ALLOC_H
+#define _ALLOC_H
+
+#include <stddef.h>
+
+/*
+ * Per-thread arena allocator
+ *
+ * Memory which lives as long as the thread allocating it can come from the
+ * arena of that thread: allocating is bumping a pointer within the current
+ * chunk of the arena, without any lock or signal masking, so that it is safe
+ * even with preemption enabled. There is no way to free an allocation: all the
+ * chunks of the arena are released at once when the thread exits, and are kept
+ * for later threads up to a limit.
+ */
+
+/*
+ * uthread_arena_alloc - Allocate memory from the arena of the current thread
+ * @size: Size of the allocation, in bytes
+ *
+ * The allocation is suitably aligned for any type, like those of malloc(), and
+ * is valid until the current thread exits. Allocations made by tasks are valid
+ * until uthread_run() returns.
+ *
+ * Return: Pointer to the allocation, NULL if not called from uthread_run(), or
+ * in case of failure when allocating a new chunk.
+ */
+void *uthread_arena_alloc(size_t size);
+
+#endif /* _ALLOC_H */
@@ -0,0 +1,182 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "private.h"
+#include "stack.h"
+
+/* Size of the huge pages the region is rounded up to */
+#define ARENA_HUGE_PAGE (2UL << 20)
+
+/* Alignment of slots which are smaller than a page */
+#define ARENA_ALIGN 64
+
+/* Number of slots per bitmap word */
+#define ARENA_WORD_BITS 64
+
+/*
+ * Stack arena
+ *
+ * One region reserved up front and cut into fixed-size slots, so that the
+ * stacks of many threads are packed next to each other (on huge pages where
+ * available) instead of being scattered across the heap. Slots are handed out
+ * lowest first, which keeps the used part of the region dense.
+ */
+static char *base;		/* Start of the region, NULL without arena */
+static size_t length;		/* Length of the mapping */
+static size_t slot_size;	/* Size of a slot, including its guard page */
+static size_t nslots;		/* Number of slots */
+static size_t nused;		/* Number of slots handed out */
+static size_t guard_size;	/* Size of the guard page, 0 if disabled */
+static uint64_t *used;		/* Bitmap of the slots handed out */
+static uint64_t *guarded;	/* Bitmap of the slots with a guard page */
+static size_t nwords;		/* Number of words of the bitmaps */
+static size_t hint;		/* Lowest word which may have a free slot */
+
+static void arena_release(void)
+{
+	if (base)
+		munmap(base, length);
+	free(used);
+	free(guarded);
+	base = NULL;
+	used = guarded = NULL;
+	nslots = 0;
+}
+
+/*
+ * Reserve @len bytes, backed by huge pages if @huge is true and the system has
+ * some to offer, either from the hugetlb pool or as transparent huge pages
+ */
+static void *arena_map(size_t len, bool huge)
+{
+	void *p;
+
+#ifdef MAP_HUGETLB
+	/* Fails right away, unlike with MAP_NORESERVE, if the pool is too small */
+	if (huge) {
+		p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (p != MAP_FAILED)
+			return p;
+	}
+#endif
+
+	p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (p == MAP_FAILED)
+		return NULL;
+
+#ifdef MADV_HUGEPAGE
+	if (huge)
+		madvise(p, len, MADV_HUGEPAGE);
+#endif
+	return p;
+}
+
+int uthread_stack_arena(size_t nstacks, size_t size, bool guard)
+{
+	size_t page = sysconf(_SC_PAGESIZE);
+	size_t i;
+
+	/* Stacks handed out by the current arena would be left dangling */
+	if (nused)
+		return -1;
+
+	if (size == 0)
+		size = UTHREAD_STACK_SIZE + (guard ? page : 0);
+	if (guard) {
+		size = (size + page - 1) & ~(page - 1);
+		if (size < 2 * page)
+			return -1;
+	} else {
+		size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+	}
+	if (nstacks > (SIZE_MAX - ARENA_HUGE_PAGE) / size)
+		return -1;
+
+	arena_release();
+	if (nstacks == 0)
+		return 0;
+
+	nwords = (nstacks + ARENA_WORD_BITS - 1) / ARENA_WORD_BITS;
+	used = calloc(nwords, sizeof(*used));
+	guarded = calloc(nwords, sizeof(*guarded));
+	length = (nstacks * size + ARENA_HUGE_PAGE - 1) & ~(ARENA_HUGE_PAGE - 1);
+
+	/* Guard pages would split the huge pages anyway */
+	base = used && guarded ? arena_map(length, !guard) : NULL;
+	if (!base) {
+		arena_release();
+		return -1;
+	}
+
+	/* Mark the bits past the last slot as used so that they are never picked */
+	for (i = nstacks; i < nwords * ARENA_WORD_BITS; i++)
+		used[i / ARENA_WORD_BITS] |= 1ULL << (i % ARENA_WORD_BITS);
+
+	slot_size = size;
+	nslots = nstacks;
+	guard_size = guard ? page : 0;
+	hint = 0;
+	return 0;
+}
+
+size_t uthread_arena_stack_size(void)
+{
+	return base ? slot_size - guard_size : 0;
+}
+
+void *uthread_arena_stack_alloc(size_t size)
+{
+	size_t w, i;
+	uint64_t bit;
+	char *slot;
+
+	if (!base || size > slot_size - guard_size)
+		return NULL;
+
+	for (w = hint; w < nwords && !~used[w]; w++)
+		;
+	hint = w;
+	if (w == nwords)
+		return NULL;
+
+	i = __builtin_ctzll(~used[w]);
+	bit = 1ULL << i;
+	used[w] |= bit;
+	nused++;
+	slot = base + (w * ARENA_WORD_BITS + i) * slot_size;
+
+	/*
+	 * Guard pages are set up lazily, as each one costs a system call and a
+	 * memory mapping. A slot keeps its guard page once it is freed, and goes
+	 * without one if the system refuses to split the mapping any further.
+	 */
+	if (guard_size && !(guarded[w] & bit) &&
+	    mprotect(slot, guard_size, PROT_NONE) == 0)
+		guarded[w] |= bit;
+
+	/* Stacks smaller than the slot sit at its top, away from the guard page */
+	return slot + slot_size - size;
+}
+
+bool uthread_arena_stack_free(void *stack)
+{
+	char *p = stack;
+	size_t i, w;
+
+	if (!base || p < base || p >= base + nslots * slot_size)
+		return false;
+
+	i = (p - base) / slot_size;
+	w = i / ARENA_WORD_BITS;
+	used[w] &= ~(1ULL << (i % ARENA_WORD_BITS));
+	nused--;
+	if (w < hint)
+		hint = w;
+	return true;
+}
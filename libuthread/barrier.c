@@ -0,0 +1,148 @@
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "barrier.h"
+#include "private.h"
+#include "queue.h"
+
+struct barrier {
+    size_t count;       // Number of threads to wait for
+    size_t arrived;     // Number of threads arrived in the current cycle
+    queue_t queue;      // Queue of threads waiting for the last one
+};
+
+struct latch {
+    size_t count;       // Number of count downs left
+    queue_t queue;      // Queue of threads waiting for the count to reach 0
+};
+
+uthread_barrier_t uthread_barrier_create(size_t count)
+{
+    if (count == 0) {
+        return NULL;
+    }
+
+    uthread_barrier_t barrier = malloc(sizeof(struct barrier));
+    if (!barrier) {
+        return NULL;
+    }
+
+    barrier->count = count;
+    barrier->arrived = 0;
+    barrier->queue = queue_create();
+    if (!barrier->queue) {
+        free(barrier);
+        return NULL;
+    }
+
+    return barrier;
+}
+
+int uthread_barrier_destroy(uthread_barrier_t barrier)
+{
+    if (!barrier || queue_length(barrier->queue) > 0) {
+        return -1;
+    }
+
+    queue_destroy(barrier->queue);
+    free(barrier);
+    return 0;
+}
+
+int uthread_barrier_wait(uthread_barrier_t barrier)
+{
+    if (!barrier) {
+        return -1;
+    }
+
+    preempt_disable();
+
+    // The last thread to arrive releases all the others at once, and starts a
+    // new cycle
+    if (++barrier->arrived == barrier->count) {
+        barrier->arrived = 0;
+        uthread_unblock_all(barrier->queue);
+        preempt_enable();
+        return 1;
+    }
+
+    if (queue_enqueue(barrier->queue, uthread_current()) == -1) {
+        barrier->arrived--;
+        preempt_enable();
+        return -1;
+    }
+    uthread_block();
+
+    // The barrier may have been reused, or destroyed, since the release, so it
+    // must not be accessed anymore
+    return 0;
+}
+
+uthread_latch_t uthread_latch_create(size_t count)
+{
+    uthread_latch_t latch = malloc(sizeof(struct latch));
+    if (!latch) {
+        return NULL;
+    }
+
+    latch->count = count;
+    latch->queue = queue_create();
+    if (!latch->queue) {
+        free(latch);
+        return NULL;
+    }
+
+    return latch;
+}
+
+int uthread_latch_destroy(uthread_latch_t latch)
+{
+    if (!latch || queue_length(latch->queue) > 0) {
+        return -1;
+    }
+
+    queue_destroy(latch->queue);
+    free(latch);
+    return 0;
+}
+
+int uthread_latch_count_down(uthread_latch_t latch)
+{
+    if (!latch) {
+        return -1;
+    }
+
+    preempt_disable();
+    if (latch->count == 0) {
+        preempt_enable();
+        return -1;
+    }
+
+    // Opening the latch releases all the waiting threads at once
+    if (--latch->count == 0) {
+        uthread_unblock_all(latch->queue);
+    }
+    preempt_enable();
+    return 0;
+}
+
+int uthread_latch_wait(uthread_latch_t latch)
+{
+    if (!latch) {
+        return -1;
+    }
+
+    preempt_disable();
+    if (latch->count > 0) {
+        if (queue_enqueue(latch->queue, uthread_current()) == -1) {
+            preempt_enable();
+            return -1;
+        }
+        uthread_block();
+
+        // As with barriers, the latch must not be accessed after the release
+        return 0;
+    }
+    preempt_enable();
+    return 0;
+}
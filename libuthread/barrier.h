@@ -0,0 +1,101 @@
+#ifndef _BARRIER_H
+#define _BARRIER_H
+
+#include <stddef.h>
+
+/*
+ * uthread_barrier_t - Barrier type
+ *
+ * A barrier makes a fixed number of threads wait for each other: threads
+ * arriving at the barrier are blocked until the last one arrives, which then
+ * releases all of them at once. The barrier is cyclic: once released, it can
+ * be used again by the same number of threads.
+ */
+typedef struct barrier *uthread_barrier_t;
+
+/*
+ * uthread_latch_t - Countdown latch type
+ *
+ * A latch is initialized with a count, which threads decrement without
+ * blocking. Threads waiting on the latch are blocked until the count reaches
+ * zero, which releases all of them at once. Unlike a barrier, a latch cannot
+ * be reused: once open, it stays open.
+ */
+typedef struct latch *uthread_latch_t;
+
+/*
+ * uthread_barrier_create - Create barrier
+ * @count: Number of threads to wait for
+ *
+ * Return: Pointer to initialized barrier. NULL if @count is 0 or in case of
+ * failure when allocating the new barrier.
+ */
+uthread_barrier_t uthread_barrier_create(size_t count);
+
+/*
+ * uthread_barrier_destroy - Deallocate a barrier
+ * @barrier: Barrier to deallocate
+ *
+ * Return: -1 if @barrier is NULL or if threads are still waiting on it. 0 if
+ * @barrier was successfully destroyed.
+ */
+int uthread_barrier_destroy(uthread_barrier_t barrier);
+
+/*
+ * uthread_barrier_wait - Wait on a barrier
+ * @barrier: Barrier to wait on
+ *
+ * Block the caller thread until @count threads (including the caller) have
+ * called this function. The last thread to arrive does not block: it moves all
+ * the waiting threads to the ready queue in one operation, in their order of
+ * arrival, and resets the barrier for its next use.
+ *
+ * Return: -1 if @barrier is NULL, or in case of failure when queueing the
+ * caller, which then does not count as arrived. 1 for the last thread to
+ * arrive, and 0 for the others, so that a single thread can be picked to run
+ * serial work.
+ */
+int uthread_barrier_wait(uthread_barrier_t barrier);
+
+/*
+ * uthread_latch_create - Create countdown latch
+ * @count: Number of count downs before the latch opens
+ *
+ * Return: Pointer to initialized latch. NULL in case of failure when allocating
+ * the new latch.
+ */
+uthread_latch_t uthread_latch_create(size_t count);
+
+/*
+ * uthread_latch_destroy - Deallocate a latch
+ * @latch: Latch to deallocate
+ *
+ * Return: -1 if @latch is NULL or if threads are still waiting on it. 0 if
+ * @latch was successfully destroyed.
+ */
+int uthread_latch_destroy(uthread_latch_t latch);
+
+/*
+ * uthread_latch_count_down - Decrement the count of a latch
+ * @latch: Latch to count down
+ *
+ * Never blocks. When the count reaches zero, all the waiting threads are moved
+ * to the ready queue in one operation, in their order of arrival.
+ *
+ * Return: -1 if @latch is NULL or if it is already open. 0 otherwise.
+ */
+int uthread_latch_count_down(uthread_latch_t latch);
+
+/*
+ * uthread_latch_wait - Wait for a latch to open
+ * @latch: Latch to wait on
+ *
+ * Block the caller thread until the count of @latch reaches zero. Returns
+ * right away if it already did.
+ *
+ * Return: -1 if @latch is NULL, or in case of failure when queueing the caller.
+ * 0 once the latch is open.
+ */
+int uthread_latch_wait(uthread_latch_t latch);
+
+#endif /* _BARRIER_H */
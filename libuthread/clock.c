@@ -0,0 +1,51 @@
+#include <stdint.h>
+#include <time.h>
+
+#include "private.h"
+
+/* Interval over which the timestamp counter is calibrated (in ns) */
+#define CALIBRATION_NS 1000000
+
+/* Number of timestamp ticks per nanosecond, 0 until calibrated */
+static double ticks_per_ns;
+
+uint64_t uthread_monotonic_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void uthread_clock_init(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	uint64_t start_ns, start_ticks, now_ns;
+
+	if (ticks_per_ns != 0)
+		return;
+
+	start_ns = uthread_monotonic_ns();
+	start_ticks = uthread_clock();
+	do {
+		now_ns = uthread_monotonic_ns();
+	} while (now_ns - start_ns < CALIBRATION_NS);
+
+	ticks_per_ns = (double)(uthread_clock() - start_ticks) /
+		(now_ns - start_ns);
+#endif
+}
+
+uint64_t uthread_clock_ns(uint64_t ticks)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	/* Only when used before the first uthread_run() */
+	if (ticks_per_ns == 0)
+		uthread_clock_init();
+
+	return (uint64_t)(ticks / ticks_per_ns);
+#else
+	/* uthread_clock() already counts nanoseconds */
+	return ticks;
+#endif
+}
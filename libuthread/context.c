@@ -1,11 +1,75 @@
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 
 #include "private.h"
 #include "uthread.h"
 
-/* Size of the stack for a thread (in bytes) */
-#define UTHREAD_STACK_SIZE 32768
+#ifdef UTHREAD_CTX_COMPACT
+
+/*
+ * uthread_ctx_swap - Save the current stack pointer in @save, then resume the
+ * context whose stack pointer is @sp
+ *
+ * Only the registers preserved across function calls by the System V ABI need
+ * to be saved, along with the SSE and x87 control words. The signal mask is the
+ * same at every switch (preemption is disabled), so unlike swapcontext() there
+ * is no system call involved.
+ */
+void uthread_ctx_swap(void **save, void *sp);
+__asm__(
+	".text\n"
+	".p2align 4\n"
+	".type uthread_ctx_swap, @function\n"
+	"uthread_ctx_swap:\n"
+	"	pushq %rbp\n"
+	"	pushq %rbx\n"
+	"	pushq %r12\n"
+	"	pushq %r13\n"
+	"	pushq %r14\n"
+	"	pushq %r15\n"
+	"	subq $8, %rsp\n"
+	"	stmxcsr (%rsp)\n"
+	"	fnstcw 4(%rsp)\n"
+	"	movq %rsp, (%rdi)\n"
+	"	movq %rsi, %rsp\n"
+	"	ldmxcsr (%rsp)\n"
+	"	fldcw 4(%rsp)\n"
+	"	addq $8, %rsp\n"
+	"	popq %r15\n"
+	"	popq %r14\n"
+	"	popq %r13\n"
+	"	popq %r12\n"
+	"	popq %rbx\n"
+	"	popq %rbp\n"
+	"	ret\n"
+	".size uthread_ctx_swap, .-uthread_ctx_swap\n"
+);
+
+/*
+ * uthread_ctx_trampoline - First code run by a new context, which finds the
+ * thread function and its argument in the registers restored by
+ * uthread_ctx_swap()
+ */
+void uthread_ctx_trampoline(void);
+__asm__(
+	".text\n"
+	".p2align 4\n"
+	".type uthread_ctx_trampoline, @function\n"
+	"uthread_ctx_trampoline:\n"
+	"	movq %r12, %rdi\n"
+	"	movq %r13, %rsi\n"
+	"	call uthread_ctx_bootstrap\n"
+	"	ud2\n"
+	".size uthread_ctx_trampoline, .-uthread_ctx_trampoline\n"
+);
+
+void uthread_ctx_switch(uthread_ctx_t *prev, uthread_ctx_t *next)
+{
+	uthread_ctx_swap(&prev->sp, next->sp);
+}
+
+#else /* !UTHREAD_CTX_COMPACT */
 
 void uthread_ctx_switch(uthread_ctx_t *prev, uthread_ctx_t *next)
 {
@@ -19,14 +83,77 @@ void uthread_ctx_switch(uthread_ctx_t *prev, uthread_ctx_t *next)
 	}
 }
 
-void *uthread_ctx_alloc_stack(void)
+#endif /* UTHREAD_CTX_COMPACT */
+
+/* Number of stack sizes, and of stacks per size, kept for reuse */
+#define STACK_POOL_SIZES 4
+#define STACK_POOL_DEPTH 16
+
+/*
+ * Pool of freed stacks, so that threads started one after the other reuse the
+ * same (cache-hot) stacks instead of going through malloc() and free(). Stacks
+ * are kept in LIFO order, linked through their lowest bytes.
+ */
+struct stack_pool {
+	size_t size;		/* Size of the stacks, 0 if unused */
+	unsigned int count;	/* Number of stacks in the list */
+	void *head;		/* Most recently freed stack */
+};
+
+static struct stack_pool pools[STACK_POOL_SIZES];
+
+static struct stack_pool *stack_pool_find(size_t size)
+{
+	int i;
+
+	for (i = 0; i < STACK_POOL_SIZES; i++)
+		if (pools[i].size == size)
+			return &pools[i];
+
+	return NULL;
+}
+
+void *uthread_ctx_alloc_stack(size_t size)
 {
-	return malloc(UTHREAD_STACK_SIZE);
+	struct stack_pool *pool = stack_pool_find(size);
+	void *stack = uthread_arena_stack_alloc(size);
+
+	if (!stack && pool && pool->head) {
+		stack = pool->head;
+		pool->head = *(void **)stack;
+		if (--pool->count == 0)
+			pool->size = 0;	/* Free for another size */
+	}
+	if (!stack)
+		stack = malloc(size);
+
+	/* Paint the stack so that its high-water mark can be measured on exit */
+	if (stack && uthread_stack_profiling())
+		uthread_stack_paint(stack, size);
+
+	return stack;
 }
 
-void uthread_ctx_destroy_stack(void *top_of_stack)
+void uthread_ctx_destroy_stack(void *top_of_stack, size_t size)
 {
-	free(top_of_stack);
+	struct stack_pool *pool;
+
+	/* The arena already recycles its slots */
+	if (uthread_arena_stack_free(top_of_stack))
+		return;
+
+	pool = stack_pool_find(size);
+	if (!pool)
+		pool = stack_pool_find(0);
+	if (!pool || pool->count == STACK_POOL_DEPTH) {
+		free(top_of_stack);
+		return;
+	}
+
+	pool->size = size;
+	*(void **)top_of_stack = pool->head;
+	pool->head = top_of_stack;
+	pool->count++;
 }
 
 /*
@@ -34,6 +161,7 @@ void uthread_ctx_destroy_stack(void *top_of_stack)
  * @func: Function to be executed by the new thread
  * @arg: Argument to be passed to the thread
  */
+__attribute__((used))
 static void uthread_ctx_bootstrap(uthread_func_t func, void *arg)
 {
 	/*
@@ -46,7 +174,40 @@ static void uthread_ctx_bootstrap(uthread_func_t func, void *arg)
 	uthread_exit();
 }
 
-int uthread_ctx_init(uthread_ctx_t *uctx, void *top_of_stack,
+#ifdef UTHREAD_CTX_COMPACT
+
+/* Default SSE and x87 control words, as set up at process startup */
+#define CTX_MXCSR 0x1f80
+#define CTX_FPUCW 0x037f
+
+int uthread_ctx_init(uthread_ctx_t *uctx, void *top_of_stack, size_t size,
+		     uthread_func_t func, void *arg)
+{
+	uintptr_t top = ((uintptr_t)top_of_stack + size) & ~(uintptr_t)15;
+	uint64_t *sp = (uint64_t *)top - 2;
+
+	/*
+	 * Lay out the frame uthread_ctx_swap() pops when first switching to the
+	 * context: its return address (the trampoline, which then runs with a
+	 * 16-byte aligned stack as the ABI requires), %rbp, %rbx, %r12 and %r13
+	 * (@func and @arg), %r14, %r15, and the control words
+	 */
+	*--sp = (uintptr_t)uthread_ctx_trampoline;
+	*--sp = 0;
+	*--sp = 0;
+	*--sp = (uintptr_t)func;
+	*--sp = (uintptr_t)arg;
+	*--sp = 0;
+	*--sp = 0;
+	*--sp = CTX_MXCSR | (uint64_t)CTX_FPUCW << 32;
+	uctx->sp = sp;
+
+	return 0;
+}
+
+#else /* !UTHREAD_CTX_COMPACT */
+
+int uthread_ctx_init(uthread_ctx_t *uctx, void *top_of_stack, size_t size,
 		     uthread_func_t func, void *arg)
 {
 	/*
@@ -59,7 +220,7 @@ int uthread_ctx_init(uthread_ctx_t *uctx, void *top_of_stack,
 	 * Change context @uctx's stack to the specified stack
 	 */
 	uctx->uc_stack.ss_sp = top_of_stack;
-	uctx->uc_stack.ss_size = UTHREAD_STACK_SIZE;
+	uctx->uc_stack.ss_size = size;
 
 	/*
 	 * Finish setting up context @uctx:
@@ -74,3 +235,4 @@ int uthread_ctx_init(uthread_ctx_t *uctx, void *top_of_stack,
 	return 0;
 }
 
+#endif /* UTHREAD_CTX_COMPACT */
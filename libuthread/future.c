@@ -0,0 +1,262 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "future.h"
+#include "private.h"
+
+/*
+ * Registration of a combinator on one of its inputs, called once the input is
+ * set
+ */
+struct future_link {
+    struct future_link *next;       // Next registration on the same input
+    uthread_future_t input;         // Future waited on, NULL once set
+    struct future_combinator *comb; // Combinator it belongs to
+    size_t index;                   // Index of @input in the combinator
+};
+
+/*
+ * State of future_when_all() and future_when_any(), owned by their result
+ */
+struct future_combinator {
+    uthread_future_t result;        // Future computed by the combinator
+    bool any;                       // Set once any input is, rather than all
+    size_t remaining;               // Inputs left to be set
+    size_t n;                       // Number of inputs
+    struct future_link links[];     // Registration on each input
+};
+
+struct uthread_future {
+    bool set;                       // Whether the value is set
+    void *value;                    // Value, once set
+    struct uthread_tcb *head;       // Oldest waiting thread, chained by TCB
+    struct uthread_tcb *tail;       // Newest waiting thread
+    size_t readers;                 // Waiting threads which did not read yet
+    struct future_link *links;      // Combinators waiting on the future
+    struct future_combinator *comb; // Combinator computing the future, if any
+};
+
+uthread_future_t future_create(void)
+{
+    uthread_future_t future = malloc(sizeof(struct uthread_future));
+    if (!future) {
+        return NULL;
+    }
+
+    future->set = false;
+    future->value = NULL;
+    future->head = NULL;
+    future->tail = NULL;
+    future->readers = 0;
+    future->links = NULL;
+    future->comb = NULL;
+    return future;
+}
+
+/*
+ * Remove @link from the registrations of its input
+ */
+static void future_unlink(struct future_link *link)
+{
+    struct future_link **pp = &link->input->links;
+
+    while (*pp != link) {
+        pp = &(*pp)->next;
+    }
+    *pp = link->next;
+}
+
+int future_destroy(uthread_future_t future)
+{
+    size_t i;
+
+    if (!future) {
+        return -1;
+    }
+
+    preempt_disable();
+    if (future->readers > 0 || future->links) {
+        preempt_enable();
+        return -1;
+    }
+
+    // Cancel the registrations of a combinator on the inputs not set yet
+    if (future->comb) {
+        for (i = 0; i < future->comb->n; i++) {
+            if (future->comb->links[i].input) {
+                future_unlink(&future->comb->links[i]);
+            }
+        }
+    }
+    preempt_enable();
+
+    free(future->comb);
+    free(future);
+    return 0;
+}
+
+/*
+ * Set @future, with preemption already disabled
+ */
+static int future_complete(uthread_future_t future, void *value)
+{
+    struct uthread_tcb *uthread, *next;
+    struct future_link *link, *next_link;
+
+    if (future->set) {
+        return -1;
+    }
+    future->set = true;
+    future->value = value;
+
+    // Wake up the waiting threads, oldest first
+    for (uthread = future->head; uthread; uthread = next) {
+        next = *uthread_link(uthread);
+        uthread_unblock(uthread);
+    }
+    future->head = NULL;
+    future->tail = NULL;
+
+    // Notify the combinators, which may complete their own result in turn
+    link = future->links;
+    future->links = NULL;
+    for (; link; link = next_link) {
+        struct future_combinator *comb = link->comb;
+
+        next_link = link->next;
+        link->input = NULL;
+        if (comb->any) {
+            future_complete(comb->result, (void *)(uintptr_t)link->index);
+        } else if (--comb->remaining == 0) {
+            future_complete(comb->result, NULL);
+        }
+    }
+    return 0;
+}
+
+int promise_set(uthread_future_t future, void *value)
+{
+    if (!future) {
+        return -1;
+    }
+
+    preempt_disable();
+    int ret = future_complete(future, value);
+    preempt_enable();
+    return ret;
+}
+
+int future_get(uthread_future_t future, void **value)
+{
+    if (!future || !value) {
+        return -1;
+    }
+
+    preempt_disable();
+    if (!future->set) {
+        struct uthread_tcb *self = uthread_current();
+
+        // Chain the thread through its TCB, which needs no allocation
+        *uthread_link(self) = NULL;
+        if (future->tail) {
+            *uthread_link(future->tail) = self;
+        } else {
+            future->head = self;
+        }
+        future->tail = self;
+        future->readers++;
+        uthread_block();
+
+        // The future cannot be destroyed until the value is read
+        preempt_disable();
+        future->readers--;
+    }
+    *value = future->value;
+    preempt_enable();
+    return 0;
+}
+
+int future_try_get(uthread_future_t future, void **value)
+{
+    if (!future || !value) {
+        return -1;
+    }
+
+    if (!future->set) {
+        return 1;
+    }
+    *value = future->value;
+    return 0;
+}
+
+/*
+ * Create the result of a combinator over @futures, registered on those of them
+ * which are not set yet
+ */
+static uthread_future_t future_combine(uthread_future_t *futures, size_t n,
+                                       bool any)
+{
+    size_t i;
+
+    if (!futures) {
+        return NULL;
+    }
+    for (i = 0; i < n; i++) {
+        if (!futures[i]) {
+            return NULL;
+        }
+    }
+
+    uthread_future_t result = future_create();
+    struct future_combinator *comb = malloc(sizeof(struct future_combinator) +
+                                            n * sizeof(struct future_link));
+    if (!result || !comb) {
+        free(result);
+        free(comb);
+        return NULL;
+    }
+    comb->result = result;
+    comb->any = any;
+    comb->remaining = n;
+    comb->n = n;
+    result->comb = comb;
+
+    preempt_disable();
+    for (i = 0; i < n; i++) {
+        struct future_link *link = &comb->links[i];
+
+        link->input = NULL;
+        link->comb = comb;
+        link->index = i;
+        if (futures[i]->set) {
+            comb->remaining--;
+            if (any) {
+                future_complete(result, (void *)(uintptr_t)i);
+            }
+            continue;
+        }
+        link->input = futures[i];
+        link->next = futures[i]->links;
+        futures[i]->links = link;
+    }
+    if (comb->remaining == 0) {
+        future_complete(result, NULL);
+    }
+    preempt_enable();
+    return result;
+}
+
+uthread_future_t future_when_all(uthread_future_t *futures, size_t n)
+{
+    return future_combine(futures, n, false);
+}
+
+uthread_future_t future_when_any(uthread_future_t *futures, size_t n)
+{
+    if (n == 0) {
+        return NULL;
+    }
+    return future_combine(futures, n, true);
+}
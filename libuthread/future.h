@@ -0,0 +1,103 @@
+#ifndef _FUTURE_H
+#define _FUTURE_H
+
+#include <stddef.h>
+
+/*
+ * uthread_future_t - Future type
+ *
+ * A future holds a value which is not known yet. One thread (or task) sets it
+ * once through the promise side of the future, with promise_set(), and other
+ * threads get it, blocking until it is set. Waiting threads are chained
+ * through their TCB, so a future costs a single allocation however many
+ * threads wait on it, and completing a future nobody waits on allocates
+ * nothing.
+ */
+typedef struct uthread_future *uthread_future_t;
+
+/*
+ * future_create - Create future
+ *
+ * Return: Pointer to initialized future, not set yet. NULL in case of failure
+ * when allocating the new future.
+ */
+uthread_future_t future_create(void);
+
+/*
+ * future_destroy - Deallocate a future
+ * @future: Future to deallocate
+ *
+ * Futures returned by future_when_all() and future_when_any() can be destroyed
+ * before their inputs are set, which cancels them.
+ *
+ * Return: -1 if @future is NULL, if threads are still waiting on it or about to
+ * read its value, or if a combinator still waits on it. 0 if @future was
+ * successfully destroyed.
+ */
+int future_destroy(uthread_future_t future);
+
+/*
+ * promise_set - Set the value of a future
+ * @future: Future to set
+ * @value: Value of the future
+ *
+ * Never blocks. All the threads waiting on @future are moved to the ready queue,
+ * in their order of arrival, and the combinators waiting on it are notified.
+ *
+ * Return: -1 if @future is NULL or if it is already set. 0 otherwise.
+ */
+int promise_set(uthread_future_t future, void *value);
+
+/*
+ * future_get - Get the value of a future
+ * @future: Future to get the value of
+ * @value: Address where to store the value
+ *
+ * Block the caller thread until @future is set. Returns right away if it
+ * already is.
+ *
+ * Return: -1 if @future or @value is NULL. 0 once the value is stored.
+ */
+int future_get(uthread_future_t future, void **value);
+
+/*
+ * future_try_get - Get the value of a future without blocking
+ * @future: Future to get the value of
+ * @value: Address where to store the value
+ *
+ * Return: -1 if @future or @value is NULL. 0 if @future is set and its value
+ * was stored, 1 if @future is not set yet.
+ */
+int future_try_get(uthread_future_t future, void **value);
+
+/*
+ * future_when_all - Combine futures into a future set once all are set
+ * @futures: Array of futures
+ * @n: Number of futures in @futures
+ *
+ * The value of the returned future is NULL. It is set right away if @n is 0 or
+ * if all of @futures are already set. None of @futures can be destroyed until
+ * it is set, or until the returned future is destroyed.
+ *
+ * Return: Pointer to the combined future. NULL if @futures or one of its
+ * futures is NULL, or in case of failure (memory allocation).
+ */
+uthread_future_t future_when_all(uthread_future_t *futures, size_t n);
+
+/*
+ * future_when_any - Combine futures into a future set once one is set
+ * @futures: Array of futures
+ * @n: Number of futures in @futures
+ *
+ * The value of the returned future is the index in @futures of the first future
+ * to be set (cast to void *), whose value can then be retrieved with
+ * future_try_get(). It is set right away if one of @futures already is. None of
+ * @futures can be destroyed until it is set, or until the returned future is
+ * destroyed.
+ *
+ * Return: Pointer to the combined future. NULL if @futures or one of its
+ * futures is NULL, if @n is 0, or in case of failure (memory allocation).
+ */
+uthread_future_t future_when_any(uthread_future_t *futures, size_t n);
+
+#endif /* _FUTURE_H */
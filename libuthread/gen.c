@@ -0,0 +1,121 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "gen.h"
+#include "private.h"
+
+struct uthread_gen {
+    uthread_func_t func;    // Function producing the values
+    void *arg;              // Argument of the function
+    uthread_t producer;     // Thread running the function, NULL until started
+    uthread_t consumer;     // Thread waiting for a value, NULL if none
+    void *value;            // Last value handed over
+    bool finished;          // Whether the function returned
+    bool cancelled;         // Whether the generator is being destroyed
+};
+
+/*
+ * Entry function of the generator threads
+ */
+static void gen_main(void *arg)
+{
+    uthread_gen_t gen = arg;
+
+    *uthread_local() = gen;
+    gen->func(gen->arg);
+
+    // The consumer goes back through the scheduler, since this thread exits
+    gen->finished = true;
+    uthread_resume(gen->consumer);
+}
+
+uthread_gen_t uthread_gen_create(uthread_func_t func, void *arg)
+{
+    if (!func) {
+        return NULL;
+    }
+
+    uthread_gen_t gen = malloc(sizeof(struct uthread_gen));
+    if (!gen) {
+        return NULL;
+    }
+
+    gen->func = func;
+    gen->arg = arg;
+    gen->producer = NULL;
+    gen->consumer = NULL;
+    gen->value = NULL;
+    gen->finished = false;
+    gen->cancelled = false;
+
+    return gen;
+}
+
+/*
+ * Run @gen until it yields a value or finishes
+ */
+static int gen_run(uthread_gen_t gen)
+{
+    if (!gen->producer) {
+        gen->producer = uthread_create_suspended(gen_main, gen);
+        if (!gen->producer) {
+            return -1;
+        }
+    }
+
+    gen->consumer = uthread_self();
+    int ret = uthread_switch_to(gen->producer);
+    gen->consumer = NULL;
+    return ret;
+}
+
+int uthread_gen_destroy(uthread_gen_t gen)
+{
+    if (!gen || gen->consumer) {
+        return -1;
+    }
+
+    // Let a started generator unwind, a new one never runs at all
+    gen->cancelled = true;
+    while (gen->producer && !gen->finished) {
+        if (gen_run(gen) == -1) {
+            return -1;
+        }
+    }
+
+    free(gen);
+    return 0;
+}
+
+int uthread_gen_next(uthread_gen_t gen, void **value)
+{
+    if (!gen || !value || gen->consumer) {
+        return -1;
+    }
+
+    if (!gen->finished && gen_run(gen) == -1) {
+        return -1;
+    }
+
+    if (gen->finished) {
+        return 1;
+    }
+    *value = gen->value;
+    return 0;
+}
+
+int uthread_gen_yield(void *value)
+{
+    uthread_gen_t gen = uthread_self() ? *uthread_local() : NULL;
+
+    if (!gen || gen->cancelled) {
+        return -1;
+    }
+
+    gen->value = value;
+    uthread_switch_to(gen->consumer);
+
+    // The destroyer, rather than a consumer, may be the one switching back
+    return gen->cancelled ? -1 : 0;
+}
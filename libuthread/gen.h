@@ -0,0 +1,69 @@
+#ifndef _GEN_H
+#define _GEN_H
+
+#include "uthread.h"
+
+/*
+ * uthread_gen_t - Generator type
+ *
+ * A generator is a thread producing a sequence of values for a consumer
+ * thread. The consumer asks for the next value with uthread_gen_next(), which
+ * runs the generator until it hands a value over with uthread_gen_yield(). The
+ * CPU goes straight from one to the other with uthread_switch_to(), without
+ * either of them going through the scheduler.
+ */
+typedef struct uthread_gen *uthread_gen_t;
+
+/*
+ * uthread_gen_create - Create generator
+ * @func: Function producing the values
+ * @arg: Argument to be passed to @func
+ *
+ * The thread running @func is only created by the first call to
+ * uthread_gen_next(). Once @func returns, the generator is finished.
+ *
+ * Return: Pointer to initialized generator. NULL in case of failure when
+ * allocating the new generator.
+ */
+uthread_gen_t uthread_gen_create(uthread_func_t func, void *arg);
+
+/*
+ * uthread_gen_destroy - Deallocate a generator
+ * @gen: Generator to deallocate
+ *
+ * If the generator is not finished, it is run one last time, with
+ * uthread_gen_yield() returning -1 so that its function knows to return.
+ *
+ * Return: -1 if @gen is NULL or if a consumer is waiting on it. 0 if @gen was
+ * successfully destroyed.
+ */
+int uthread_gen_destroy(uthread_gen_t gen);
+
+/*
+ * uthread_gen_next - Get the next value of a generator
+ * @gen: Generator to run
+ * @value: Address where to store the next value
+ *
+ * Run @gen until it yields a value, or until it is finished. Only one thread
+ * at a time can consume the values of a generator.
+ *
+ * Return: 0 if a value was stored in @value, 1 if the generator is finished.
+ * -1 if @gen or @value is NULL, if another thread is waiting on @gen, or in
+ * case of failure when creating the generator thread.
+ */
+int uthread_gen_next(uthread_gen_t gen, void **value);
+
+/*
+ * uthread_gen_yield - Hand a value over to the consumer of a generator
+ * @value: Value to return from uthread_gen_next()
+ *
+ * To be called by the function of a generator. The generator is suspended
+ * until the next call to uthread_gen_next().
+ *
+ * Return: 0 once the next value is asked for. -1 if the calling thread is not a
+ * generator, or if the generator is being destroyed, in which case its
+ * function must return.
+ */
+int uthread_gen_yield(void *value);
+
+#endif /* _GEN_H */
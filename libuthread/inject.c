@@ -0,0 +1,159 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "private.h"
+
+/*
+ * Injection queue
+ *
+ * Intrusive multi-producer/single-consumer queue (after Dmitry Vyukov's
+ * design), through which threads other than the uthread runtime, and signal
+ * handlers, hand work over to the scheduler. Producers only perform an atomic
+ * exchange and a store, and never wait on each other or on the consumer.
+ *
+ * Nodes are pushed at @head and popped at @tail. The stub node keeps the queue
+ * non-empty, so that producers never need to look at @tail.
+ */
+static struct uthread_inject stub;
+static _Atomic(struct uthread_inject *) head = &stub;
+static struct uthread_inject *tail = &stub;
+
+/* Doorbell on which the idle thread sleeps, -1 if unavailable */
+static int doorbell = -1;
+
+/* Whether the idle thread is (about to be) sleeping on the doorbell */
+static atomic_bool sleeping;
+
+int uthread_inject_init(void)
+{
+	/* Without doorbell, the idle thread polls the queue instead */
+	if (doorbell < 0)
+		doorbell = eventfd(0, EFD_CLOEXEC);
+	return 0;
+}
+
+static void inject_push(struct uthread_inject *node)
+{
+	struct uthread_inject *prev;
+
+	atomic_store_explicit(&node->next, NULL, memory_order_relaxed);
+	prev = atomic_exchange(&head, node);
+	atomic_store_explicit(&prev->next, node, memory_order_release);
+}
+
+void uthread_inject(struct uthread_inject *node)
+{
+	inject_push(node);
+
+	/* Only ring the doorbell if the idle thread may be waiting for it */
+	if (atomic_load(&sleeping) && doorbell >= 0) {
+		uint64_t one = 1;
+		ssize_t ret;
+
+		do {
+			ret = write(doorbell, &one, sizeof(one));
+		} while (ret < 0 && errno == EINTR);
+	}
+}
+
+/*
+ * Pop the oldest node, or return NULL if the queue is empty or if the oldest
+ * producer has not finished linking its node yet
+ */
+static struct uthread_inject *inject_pop(void)
+{
+	struct uthread_inject *node = tail;
+	struct uthread_inject *next =
+		atomic_load_explicit(&node->next, memory_order_acquire);
+
+	if (node == &stub) {
+		if (!next)
+			return NULL;
+		tail = next;
+		node = next;
+		next = atomic_load_explicit(&node->next, memory_order_acquire);
+	}
+
+	if (next) {
+		tail = next;
+		return node;
+	}
+
+	/* @node is the last node, unless a producer is halfway through */
+	if (node != atomic_load(&head))
+		return NULL;
+
+	/* Put the stub back behind the last node so that it can be popped */
+	inject_push(&stub);
+	next = atomic_load_explicit(&node->next, memory_order_acquire);
+	if (next) {
+		tail = next;
+		return node;
+	}
+
+	return NULL;
+}
+
+bool uthread_inject_pending(void)
+{
+	return tail != &stub || atomic_load(&head) != &stub;
+}
+
+void uthread_inject_drain(void)
+{
+	struct uthread_inject *node;
+
+	if (!uthread_inject_pending())
+		return;
+
+	while ((node = inject_pop()))
+		node->func(node);
+}
+
+/*
+ * Wait for at most @timeout nanoseconds (forever if negative) for the doorbell
+ * to ring, or for a file descriptor to be ready, then reset the doorbell
+ */
+static void inject_poll(int64_t timeout)
+{
+	struct pollfd pfds[2] = {
+		{ .fd = doorbell, .events = POLLIN },
+		{ .fd = uthread_io_fd(), .events = POLLIN },
+	};
+	struct timespec ts = {
+		.tv_sec = timeout / 1000000000,
+		.tv_nsec = timeout % 1000000000,
+	};
+	uint64_t count;
+
+	if (ppoll(pfds, 2, timeout < 0 ? NULL : &ts, NULL) > 0 &&
+	    (pfds[0].revents & POLLIN)) {
+		while (read(doorbell, &count, sizeof(count)) < 0 &&
+		       errno == EINTR)
+			;
+	}
+}
+
+void uthread_inject_wait(int64_t timeout)
+{
+	/*
+	 * Announce the idle thread is going to sleep before checking the queue
+	 * one last time, so that a producer either sees the announcement and
+	 * rings the doorbell, or has its node seen by the check
+	 */
+	atomic_store(&sleeping, true);
+	if ((doorbell >= 0 || uthread_io_fd() >= 0) &&
+	    !uthread_inject_pending())
+		inject_poll(timeout);
+	atomic_store(&sleeping, false);
+
+	uthread_inject_drain();
+}
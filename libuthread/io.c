@@ -0,0 +1,256 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "io.h"
+#include "private.h"
+
+/* Number of events fetched per epoll_wait() call */
+#define IO_BATCH 256
+
+/* Number of calls to uthread_io_check() between two polls */
+#define IO_CHECK_INTERVAL 64
+
+/* Threads waiting on a file descriptor */
+struct io_fd {
+	struct uthread_tcb *reader;	/* Thread waiting for POLLIN */
+	struct uthread_tcb *writer;	/* Thread waiting for POLLOUT */
+	bool registered;		/* Whether the fd was added to the epoll set */
+};
+
+/*
+ * Waiters are indexed by file descriptor, and the epoll set watches the file
+ * descriptors they wait on, in one-shot mode so that nothing is reported once
+ * they are woken up
+ */
+static int epfd = -1;
+static struct io_fd *fds;
+static size_t nr_fds;
+static size_t nr_waiting;
+static unsigned int checks;
+
+int uthread_io_fd(void)
+{
+	return nr_waiting ? epfd : -1;
+}
+
+/* Make room for @fd in the table of waiters */
+static int io_reserve(int fd)
+{
+	size_t n = nr_fds ? nr_fds : 64;
+	struct io_fd *grown;
+
+	if ((size_t)fd < nr_fds)
+		return 0;
+
+	while (n <= (size_t)fd)
+		n *= 2;
+	grown = realloc(fds, n * sizeof(*fds));
+	if (!grown)
+		return -1;
+	for (; nr_fds < n; nr_fds++)
+		grown[nr_fds] = (struct io_fd){ NULL, NULL, false };
+	fds = grown;
+	return 0;
+}
+
+/* Watch @fd for the events its waiters wait for */
+static int io_arm(int fd, struct io_fd *f)
+{
+	struct epoll_event ev = {
+		.events = EPOLLONESHOT | (f->reader ? EPOLLIN : 0) |
+			  (f->writer ? EPOLLOUT : 0),
+		.data.fd = fd,
+	};
+
+	/*
+	 * The fd leaves the epoll set when closed, and its number can then be
+	 * reused, so the registration flag is only a hint
+	 */
+	if (f->registered && epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev) == 0)
+		return 0;
+	if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == 0 ||
+	    (errno == EEXIST && epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev) == 0)) {
+		f->registered = true;
+		return 0;
+	}
+	return -1;
+}
+
+int uthread_io_wait(int fd, short events)
+{
+	struct io_fd *f;
+
+	if (fd < 0 || !events || (events & ~(POLLIN | POLLOUT))) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	preempt_disable();
+	if (epfd < 0)
+		epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (epfd < 0 || io_reserve(fd) == -1) {
+		preempt_enable();
+		return -1;
+	}
+
+	f = &fds[fd];
+	if (((events & POLLIN) && f->reader) ||
+	    ((events & POLLOUT) && f->writer)) {
+		preempt_enable();
+		errno = EBUSY;
+		return -1;
+	}
+
+	if (events & POLLIN)
+		f->reader = uthread_current();
+	if (events & POLLOUT)
+		f->writer = uthread_current();
+	if (io_arm(fd, f) == -1) {
+		int err = errno;
+
+		if (events & POLLIN)
+			f->reader = NULL;
+		if (events & POLLOUT)
+			f->writer = NULL;
+		preempt_enable();
+
+		/* Regular files and directories are always ready */
+		if (err == EPERM)
+			return 0;
+		errno = err;
+		return -1;
+	}
+
+	nr_waiting += !!(events & POLLIN) + !!(events & POLLOUT);
+	uthread_block();
+	return 0;
+}
+
+/* Wake up the waiters of @fd concerned by @events, and re-arm the others */
+static void io_ready(int fd, uint32_t events)
+{
+	struct io_fd *f = &fds[fd];
+	struct uthread_tcb *reader = f->reader, *writer = f->writer;
+
+	if (events & (EPOLLERR | EPOLLHUP))
+		events |= EPOLLIN | EPOLLOUT;
+
+	if ((events & EPOLLIN) && f->reader) {
+		f->reader = NULL;
+		nr_waiting--;
+	}
+	if ((events & EPOLLOUT) && f->writer) {
+		f->writer = NULL;
+		nr_waiting--;
+	}
+
+	/* A thread waiting for both events is woken up by either */
+	if (reader == writer && (!f->reader || !f->writer)) {
+		nr_waiting -= !!f->reader + !!f->writer;
+		f->reader = f->writer = NULL;
+	}
+
+	/* Wake both waiters up at once if re-arming fails */
+	if ((f->reader || f->writer) && io_arm(fd, f) == -1) {
+		nr_waiting -= !!f->reader + !!f->writer;
+		f->reader = f->writer = NULL;
+	}
+
+	if (reader && !f->reader)
+		uthread_unblock(reader);
+	if (writer && writer != reader && !f->writer)
+		uthread_unblock(writer);
+}
+
+void uthread_io_poll(void)
+{
+	struct epoll_event events[IO_BATCH];
+	int n, i;
+
+	checks = 0;
+	do {
+		if (!nr_waiting)
+			return;
+		n = epoll_wait(epfd, events, IO_BATCH, 0);
+		for (i = 0; i < n; i++)
+			io_ready(events[i].data.fd, events[i].events);
+	} while (n == IO_BATCH);
+}
+
+void uthread_io_check(void)
+{
+	if (nr_waiting && ++checks >= IO_CHECK_INTERVAL)
+		uthread_io_poll();
+}
+
+ssize_t uthread_read(int fd, void *buf, size_t count)
+{
+	ssize_t ret;
+
+	while ((ret = read(fd, buf, count)) < 0) {
+		if (errno == EINTR)
+			continue;
+		if ((errno != EAGAIN && errno != EWOULDBLOCK) ||
+		    uthread_io_wait(fd, POLLIN) == -1)
+			return -1;
+	}
+	return ret;
+}
+
+ssize_t uthread_write(int fd, const void *buf, size_t count)
+{
+	ssize_t ret;
+
+	while ((ret = write(fd, buf, count)) < 0) {
+		if (errno == EINTR)
+			continue;
+		if ((errno != EAGAIN && errno != EWOULDBLOCK) ||
+		    uthread_io_wait(fd, POLLOUT) == -1)
+			return -1;
+	}
+	return ret;
+}
+
+int uthread_accept(int fd, struct sockaddr *addr, socklen_t *addrlen)
+{
+	int ret;
+
+	while ((ret = accept4(fd, addr, addrlen,
+			      SOCK_NONBLOCK | SOCK_CLOEXEC)) < 0) {
+		if (errno == EINTR)
+			continue;
+		if ((errno != EAGAIN && errno != EWOULDBLOCK) ||
+		    uthread_io_wait(fd, POLLIN) == -1)
+			return -1;
+	}
+	return ret;
+}
+
+int uthread_connect(int fd, const struct sockaddr *addr, socklen_t addrlen)
+{
+	socklen_t len = sizeof(int);
+	int err;
+
+	if (connect(fd, addr, addrlen) == 0)
+		return 0;
+	if (errno != EINPROGRESS && errno != EINTR)
+		return -1;
+
+	/* The outcome of the connection is known once the socket is writable */
+	if (uthread_io_wait(fd, POLLOUT) == -1 ||
+	    getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == -1)
+		return -1;
+	if (err) {
+		errno = err;
+		return -1;
+	}
+	return 0;
+}
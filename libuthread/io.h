@@ -0,0 +1,80 @@
+#ifndef _IO_H
+#define _IO_H
+
+#include <sys/socket.h>
+#include <sys/types.h>
+
+/*
+ * I/O wrappers
+ *
+ * Same as their system call counterparts, but on file descriptors in
+ * non-blocking mode: instead of failing with EAGAIN, they block the calling
+ * thread until the file descriptor is ready, and let the other threads run in
+ * the meantime. The scheduler checks which file descriptors are ready when it
+ * has nothing else to run, and every so often otherwise.
+ *
+ * At most one thread can wait for a file descriptor to be readable, and one
+ * for it to be writable, at a time. These functions must be called by threads,
+ * not by tasks, which cannot block.
+ */
+
+/*
+ * uthread_io_wait - Wait for a file descriptor to be ready
+ * @fd: File descriptor
+ * @events: POLLIN to wait for @fd to be readable, POLLOUT to be writable, or
+ * both
+ *
+ * Block the calling thread until @fd is ready for one of @events, or has an
+ * error or hung up. Files which cannot be waited on, such as regular files,
+ * are always ready.
+ *
+ * Return: -1 if @events is invalid, if another thread is already waiting for
+ * the same event on @fd (errno set to EBUSY), or if @fd cannot be watched. 0
+ * once @fd is ready.
+ */
+int uthread_io_wait(int fd, short events);
+
+/*
+ * uthread_read - Read from a file descriptor
+ * @fd: File descriptor, in non-blocking mode
+ * @buf: Buffer to read into
+ * @count: Maximum number of bytes to read
+ *
+ * Return: Number of bytes read, 0 at the end of file, -1 in case of failure
+ * (errno set)
+ */
+ssize_t uthread_read(int fd, void *buf, size_t count);
+
+/*
+ * uthread_write - Write to a file descriptor
+ * @fd: File descriptor, in non-blocking mode
+ * @buf: Buffer to write
+ * @count: Number of bytes to write
+ *
+ * Return: Number of bytes written, which may be less than @count, -1 in case
+ * of failure (errno set)
+ */
+ssize_t uthread_write(int fd, const void *buf, size_t count);
+
+/*
+ * uthread_accept - Accept a connection on a socket
+ * @fd: Listening socket, in non-blocking mode
+ * @addr: Address of the peer, or NULL
+ * @addrlen: Size of @addr, or NULL
+ *
+ * Return: Socket of the new connection, in non-blocking mode, -1 in case of
+ * failure (errno set)
+ */
+int uthread_accept(int fd, struct sockaddr *addr, socklen_t *addrlen);
+
+/*
+ * uthread_connect - Connect a socket
+ * @fd: Socket, in non-blocking mode
+ * @addr: Address to connect to
+ * @addrlen: Size of @addr
+ *
+ * Return: 0 once connected, -1 in case of failure (errno set)
+ */
+int uthread_connect(int fd, const struct sockaddr *addr, socklen_t addrlen);
+
+#endif /* _IO_H */
@@ -0,0 +1,205 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "latency.h"
+#include "private.h"
+
+#ifdef UTHREAD_LATENCY
+
+/* Histogram buckets, bucket b counting durations below 2^b nanoseconds */
+#define LATENCY_NR_BUCKETS 40
+
+/* Number of call sites that can be profiled, must be a power of two */
+#define LATENCY_NR_SITES 256
+
+struct latency_hist {
+	unsigned long count;
+	uint64_t total_ns;
+	uint64_t max_ns;
+	unsigned long buckets[LATENCY_NR_BUCKETS];
+};
+
+/* Masked durations of a call site of preempt_disable() */
+struct latency_site {
+	void *site;		/* Return address, NULL if unused */
+	struct latency_hist hist;
+};
+
+bool uthread_latency_enabled;
+
+static struct latency_site sites[LATENCY_NR_SITES];
+static struct latency_hist alarms;
+
+/* Masked region in progress, if @region_site is not NULL */
+static void *region_site;
+static uint64_t region_start;
+
+/* Last alarm not followed by a switch yet, if @alarm_at is not 0 */
+static uint64_t alarm_at;
+static uint64_t alarm_late_ns;
+
+static void latency_add(struct latency_hist *h, uint64_t ns)
+{
+	unsigned int b = ns ? 64 - __builtin_clzll(ns) : 0;
+
+	if (b >= LATENCY_NR_BUCKETS)
+		b = LATENCY_NR_BUCKETS - 1;
+	h->buckets[b]++;
+	h->count++;
+	h->total_ns += ns;
+	if (ns > h->max_ns)
+		h->max_ns = ns;
+}
+
+/*
+ * Find the entry of @site in the open-addressing hash table, creating it if
+ * needed. Return NULL if the table is full.
+ */
+static struct latency_site *latency_lookup(void *site)
+{
+	size_t h = ((uintptr_t)site >> 2) & (LATENCY_NR_SITES - 1);
+	size_t i;
+
+	for (i = 0; i < LATENCY_NR_SITES; i++) {
+		struct latency_site *e = &sites[(h + i) & (LATENCY_NR_SITES - 1)];
+
+		if (e->site == site)
+			return e;
+		if (!e->site) {
+			e->site = site;
+			return e;
+		}
+	}
+
+	return NULL;
+}
+
+void uthread_latency_masked(void *site)
+{
+	/* Already masked, preempt_disable() does not nest */
+	if (region_site)
+		return;
+
+	region_site = site;
+	region_start = uthread_clock();
+}
+
+void uthread_latency_unmasked(void)
+{
+	struct latency_site *e;
+
+	if (!region_site)
+		return;
+
+	e = latency_lookup(region_site);
+	if (e)
+		latency_add(&e->hist,
+			    uthread_clock_ns(uthread_clock() - region_start));
+	region_site = NULL;
+}
+
+void uthread_latency_alarm(uint64_t late_ns)
+{
+	alarm_at = uthread_clock();
+	alarm_late_ns = late_ns;
+}
+
+void uthread_latency_switch(void)
+{
+	if (!alarm_at)
+		return;
+
+	latency_add(&alarms,
+		    alarm_late_ns + uthread_clock_ns(uthread_clock() - alarm_at));
+	alarm_at = 0;
+}
+
+int uthread_latency_start(void)
+{
+	preempt_disable();
+	uthread_clock_init();
+	memset(sites, 0, sizeof(sites));
+	memset(&alarms, 0, sizeof(alarms));
+	region_site = NULL;
+	alarm_at = 0;
+	uthread_latency_enabled = true;
+	preempt_enable();
+	return 0;
+}
+
+void uthread_latency_stop(void)
+{
+	uthread_latency_enabled = false;
+	region_site = NULL;
+	alarm_at = 0;
+}
+
+static void latency_print(FILE *f, const struct latency_hist *h)
+{
+	unsigned int b;
+
+	fprintf(f, " %8lu %10.0f %10llu ", h->count,
+		h->count ? (double)h->total_ns / h->count : 0.0,
+		(unsigned long long)h->max_ns);
+	for (b = 0; b < LATENCY_NR_BUCKETS; b++)
+		if (h->buckets[b])
+			fprintf(f, " <%llu:%lu", 1ULL << b, h->buckets[b]);
+	fprintf(f, "\n");
+}
+
+static int latency_cmp(const void *a, const void *b)
+{
+	const struct latency_site *x = *(const struct latency_site **)a;
+	const struct latency_site *y = *(const struct latency_site **)b;
+
+	return (y->hist.max_ns > x->hist.max_ns) -
+	       (y->hist.max_ns < x->hist.max_ns);
+}
+
+int uthread_latency_dump(FILE *f)
+{
+	struct latency_site *sorted[LATENCY_NR_SITES];
+	size_t i, n = 0;
+
+	if (!f)
+		return -1;
+
+	for (i = 0; i < LATENCY_NR_SITES; i++)
+		if (sites[i].site)
+			sorted[n++] = &sites[i];
+	qsort(sorted, n, sizeof(*sorted), latency_cmp);
+
+	fprintf(f, "%-18s %8s %10s %10s  histogram (<ns:count)\n",
+		"site", "count", "mean_ns", "max_ns");
+	fprintf(f, "%-18s", "preemption delay");
+	latency_print(f, &alarms);
+	for (i = 0; i < n; i++) {
+		fprintf(f, "%-18p", sorted[i]->site);
+		latency_print(f, &sorted[i]->hist);
+	}
+
+	return 0;
+}
+
+#else /* !UTHREAD_LATENCY */
+
+int uthread_latency_start(void)
+{
+	return -1;
+}
+
+void uthread_latency_stop(void)
+{
+}
+
+int uthread_latency_dump(FILE *f)
+{
+	(void)f;
+	return -1;
+}
+
+#endif /* UTHREAD_LATENCY */
@@ -0,0 +1,53 @@
+#ifndef _LATENCY_H
+#define _LATENCY_H
+
+#include <stdio.h>
+
+/*
+ * Preemption latency profiling
+ *
+ * When the library is compiled with latency profiling support (the default,
+ * unless built with `make LATENCY=0`), and preemption is enabled, two things
+ * can be measured:
+ *
+ * - How long the preemption signal stays masked, from preempt_disable() to
+ *   preempt_enable(), per call site of the preempt_disable() which masked it.
+ * - How late a preemption is: the time between the expiry of the timer and
+ *   the switch to the next thread, which includes the time the signal waited
+ *   for a masked region to end.
+ *
+ * Durations are counted in log2-sized histogram buckets. While profiling is
+ * stopped, the instrumentation costs a single branch.
+ */
+
+/*
+ * uthread_latency_start - Start profiling
+ *
+ * Any previously recorded measurement is discarded.
+ *
+ * Return: -1 if the library was compiled without profiling support, 0
+ * otherwise.
+ */
+int uthread_latency_start(void);
+
+/*
+ * uthread_latency_stop - Stop profiling
+ *
+ * The measurements are kept until the next call to uthread_latency_start().
+ */
+void uthread_latency_stop(void);
+
+/*
+ * uthread_latency_dump - Print the histograms
+ * @f: Stream to write to
+ *
+ * Print the histogram of preemption delays, then one histogram of masked
+ * durations per call site, the sites with the longest durations first. Call
+ * sites are return addresses, which addr2line can translate.
+ *
+ * Return: -1 if @f is NULL or if the library was compiled without profiling
+ * support, 0 otherwise.
+ */
+int uthread_latency_dump(FILE *f);
+
+#endif /* _LATENCY_H */
@@ -0,0 +1,24 @@
+#include <stddef.h>
+
+#include "mutex.h"
+#include "sem.h"
+
+mutex_t mutex_create(const char *name)
+{
+    return sem_create_lock(name);
+}
+
+int mutex_destroy(mutex_t mutex)
+{
+    return sem_destroy(mutex);
+}
+
+int mutex_lock(mutex_t mutex)
+{
+    return sem_down(mutex);
+}
+
+int mutex_unlock(mutex_t mutex)
+{
+    return sem_up(mutex);
+}
@@ -0,0 +1,56 @@
+#ifndef _MUTEX_H
+#define _MUTEX_H
+
+#include "sem.h"
+
+/*
+ * mutex_t - Mutex type
+ *
+ * A mutex is a lock-mode semaphore (see sem_create_lock()): it has an owner,
+ * which alone can unlock it, and which inherits the priority of the threads
+ * waiting for it. Mutexes can also be handed to the semaphore functions, such
+ * as sem_report() and sem_stats_get().
+ */
+typedef sem_t mutex_t;
+
+/*
+ * mutex_create - Create mutex
+ * @name: Name shown by sem_report(), copied, or NULL
+ *
+ * Return: Pointer to initialized mutex, unlocked. NULL in case of failure when
+ * allocating the new mutex.
+ */
+mutex_t mutex_create(const char *name);
+
+/*
+ * mutex_destroy - Deallocate a mutex
+ * @mutex: Mutex to deallocate
+ *
+ * Return: -1 if @mutex is NULL, locked, or if threads are waiting for it. 0 if
+ * @mutex was successfully destroyed.
+ */
+int mutex_destroy(mutex_t mutex);
+
+/*
+ * mutex_lock - Lock a mutex
+ * @mutex: Mutex to lock
+ *
+ * Block the caller thread until @mutex is unlocked, lending its priority to the
+ * owner in the meantime, then lock it.
+ *
+ * Return: -1 if @mutex is NULL or already locked by the caller, 0 once locked.
+ */
+int mutex_lock(mutex_t mutex);
+
+/*
+ * mutex_unlock - Unlock a mutex
+ * @mutex: Mutex to unlock
+ *
+ * Hand @mutex over to the oldest waiting thread, if any, and give back the
+ * priority inherited through it.
+ *
+ * Return: -1 if @mutex is NULL or not locked by the caller, 0 otherwise.
+ */
+int mutex_unlock(mutex_t mutex);
+
+#endif /* _MUTEX_H */
@@ -0,0 +1,151 @@
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "parallel.h"
+#include "private.h"
+
+/* Child spawned by uthread_spawn() */
+struct parallel_child {
+    struct uthread_group *group;    // Group to report to
+    uthread_func_t func;            // Function of the child
+    void *arg;                      // Argument of the function
+};
+
+static void parallel_child_main(void *arg)
+{
+    struct parallel_child child = *(struct parallel_child *)arg;
+
+    free(arg);
+    child.func(child.arg);
+
+    // The last child wakes up the parent, which may then reuse the group
+    preempt_disable();
+    if (--child.group->pending == 0 && child.group->waiter) {
+        uthread_t waiter = child.group->waiter;
+
+        child.group->waiter = NULL;
+        uthread_unblock(waiter);
+    }
+    preempt_enable();
+}
+
+int uthread_spawn(struct uthread_group *group, uthread_func_t func, void *arg)
+{
+    if (!group || !func) {
+        return -1;
+    }
+
+    struct parallel_child *child = malloc(sizeof(struct parallel_child));
+    if (!child) {
+        return -1;
+    }
+    child->group = group;
+    child->func = func;
+    child->arg = arg;
+
+    preempt_disable();
+    if (uthread_create(parallel_child_main, child) == -1) {
+        preempt_enable();
+        free(child);
+        return -1;
+    }
+    group->pending++;
+    preempt_enable();
+    return 0;
+}
+
+int uthread_sync(struct uthread_group *group)
+{
+    if (!group) {
+        return -1;
+    }
+
+    preempt_disable();
+    if (group->waiter) {
+        preempt_enable();
+        return -1;
+    }
+    if (group->pending > 0) {
+        group->waiter = uthread_current();
+        uthread_block();
+        return 0;
+    }
+    preempt_enable();
+    return 0;
+}
+
+/* Loop run by uthread_parallel_for(), shared by all the threads running it */
+struct parallel_loop {
+    size_t grain;
+    uthread_range_func_t func;
+    void *arg;
+};
+
+/* Range of a loop handed to a child */
+struct parallel_range {
+    struct parallel_loop *loop;
+    size_t begin, end;
+};
+
+static void parallel_run(struct parallel_loop *loop, size_t begin, size_t end);
+
+static void parallel_range_main(void *arg)
+{
+    struct parallel_range range = *(struct parallel_range *)arg;
+
+    free(arg);
+    parallel_run(range.loop, range.begin, range.end);
+}
+
+/*
+ * Process [@begin, @end), handing its upper half over to a new thread as long
+ * as it is large enough and no other thread is ready to run
+ */
+static void parallel_run(struct parallel_loop *loop, size_t begin, size_t end)
+{
+    struct uthread_group group = UTHREAD_GROUP_INIT;
+
+    while (end - begin > loop->grain && uthread_nr_ready() == 0) {
+        size_t mid = begin + (end - begin) / 2;
+        struct parallel_range *half = malloc(sizeof(struct parallel_range));
+
+        if (!half) {
+            break;
+        }
+        half->loop = loop;
+        half->begin = mid;
+        half->end = end;
+        if (uthread_spawn(&group, parallel_range_main, half) == -1) {
+            free(half);
+            break;
+        }
+        end = mid;
+    }
+
+    // Run what is left, letting the other threads run in between
+    while (begin < end) {
+        size_t stop = end - begin > loop->grain ? begin + loop->grain : end;
+
+        loop->func(begin, stop, loop->arg);
+        begin = stop;
+        if (begin < end && uthread_nr_ready() > 0) {
+            uthread_yield();
+        }
+    }
+
+    uthread_sync(&group);
+}
+
+int uthread_parallel_for(size_t begin, size_t end, size_t grain,
+                         uthread_range_func_t func, void *arg)
+{
+    struct parallel_loop loop = { grain ? grain : 1, func, arg };
+
+    if (!func) {
+        return -1;
+    }
+    if (begin < end) {
+        parallel_run(&loop, begin, end);
+    }
+    return 0;
+}
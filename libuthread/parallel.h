@@ -0,0 +1,74 @@
+#ifndef _PARALLEL_H
+#define _PARALLEL_H
+
+#include <stddef.h>
+
+#include "uthread.h"
+
+/*
+ * uthread_group - Group of spawned threads
+ *
+ * Fork-join helper: a thread spawns children in a group, then waits for all of
+ * them to be done with uthread_sync(). Groups are meant to live on the stack of
+ * the spawning thread, initialized with UTHREAD_GROUP_INIT, and their fields
+ * are private.
+ */
+struct uthread_group {
+	size_t pending;		/* Children not done yet */
+	uthread_t waiter;	/* Thread blocked in uthread_sync(), if any */
+};
+
+#define UTHREAD_GROUP_INIT { 0, NULL }
+
+/*
+ * uthread_spawn - Spawn a child thread in a group
+ * @group: Group of the child
+ * @func: Function to be executed by the child
+ * @arg: Argument to be passed to the child
+ *
+ * Return: 0 in case of success, -1 if @group or @func is NULL, or in case of
+ * failure (e.g., memory allocation).
+ */
+int uthread_spawn(struct uthread_group *group, uthread_func_t func, void *arg);
+
+/*
+ * uthread_sync - Wait for the children of a group
+ * @group: Group to wait on
+ *
+ * Block the caller thread until all the children spawned in @group are done.
+ * Returns right away if they already are. @group can then be used again.
+ *
+ * Return: -1 if @group is NULL or if another thread is waiting on it. 0 once
+ * all the children are done.
+ */
+int uthread_sync(struct uthread_group *group);
+
+/*
+ * uthread_range_func_t - Body of a parallel loop
+ * @begin: First index of the range to process
+ * @end: Index past the last one of the range
+ * @arg: Argument passed to uthread_parallel_for()
+ */
+typedef void (*uthread_range_func_t)(size_t begin, size_t end, void *arg);
+
+/*
+ * uthread_parallel_for - Run a loop body over a range of indices
+ * @begin: First index
+ * @end: Index past the last one
+ * @grain: Largest range passed to @func at once, 0 for 1
+ * @func: Loop body
+ * @arg: Argument to be passed to @func
+ *
+ * Call @func over subranges of at most @grain indices covering [@begin, @end),
+ * and return once all of them have been processed. Ranges are split in halves
+ * lazily: a half is only handed to a new thread when no other thread is ready
+ * to run, which would otherwise sit idle. With a single executor, as in this
+ * library, the loop thus mostly runs in the calling thread, which yields to the
+ * other ready threads between subranges so that they keep running.
+ *
+ * Return: -1 if @func is NULL, 0 once the whole range has been processed.
+ */
+int uthread_parallel_for(size_t begin, size_t end, size_t grain,
+			 uthread_range_func_t func, void *arg);
+
+#endif /* _PARALLEL_H */
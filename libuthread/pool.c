@@ -0,0 +1,216 @@
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "pool.h"
+#include "private.h"
+#include "queue.h"
+#include "sem.h"
+
+struct uthread_pool {
+    struct uthread_pool_job *ring;  // Queued jobs
+    size_t capacity;                // Size of @ring
+    size_t head;                    // Index of the oldest queued job
+    size_t queued;                  // Number of queued jobs
+    size_t pending;                 // Jobs submitted and not done yet
+    size_t nworkers;                // Number of worker threads
+    sem_t slots;                    // Free slots of @ring
+    sem_t jobs;                     // Queued jobs
+    sem_t stopped;                  // Workers which stopped
+    queue_t idle_waiters;           // Threads waiting for @pending to be 0
+};
+
+/*
+ * Take the oldest job off the queue, with preemption already disabled
+ */
+static struct uthread_pool_job pool_pop(uthread_pool_t pool)
+{
+    struct uthread_pool_job job = pool->ring[pool->head];
+
+    pool->head = (pool->head + 1) % pool->capacity;
+    pool->queued--;
+    return job;
+}
+
+/*
+ * Queue @n jobs, with preemption already disabled and free slots reserved
+ */
+static void pool_push(uthread_pool_t pool, const struct uthread_pool_job *jobs,
+                      size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        pool->ring[(pool->head + pool->queued + i) % pool->capacity] = jobs[i];
+    }
+    pool->queued += n;
+}
+
+static void pool_worker(void *arg)
+{
+    uthread_pool_t pool = arg;
+
+    while (1) {
+        sem_down(pool->jobs);
+
+        preempt_disable();
+        struct uthread_pool_job job = pool_pop(pool);
+        preempt_enable();
+        sem_up(pool->slots);
+
+        // A job without function tells the worker to stop
+        if (!job.func) {
+            break;
+        }
+        job.func(job.arg);
+
+        preempt_disable();
+        if (--pool->pending == 0) {
+            uthread_unblock_all(pool->idle_waiters);
+        }
+        preempt_enable();
+    }
+
+    // The pool may be freed as soon as the last worker stopped
+    sem_up(pool->stopped);
+}
+
+uthread_pool_t pool_create(size_t nworkers, size_t capacity)
+{
+    size_t i;
+
+    if (nworkers == 0 || capacity == 0 || !uthread_self()) {
+        return NULL;
+    }
+
+    uthread_pool_t pool = malloc(sizeof(struct uthread_pool));
+    if (!pool) {
+        return NULL;
+    }
+
+    pool->capacity = capacity;
+    pool->head = 0;
+    pool->queued = 0;
+    pool->pending = 0;
+    pool->nworkers = 0;
+    pool->ring = malloc(capacity * sizeof(struct uthread_pool_job));
+    pool->slots = sem_create(capacity);
+    pool->jobs = sem_create(0);
+    pool->stopped = sem_create(0);
+    pool->idle_waiters = queue_create();
+    if (!pool->ring || !pool->slots || !pool->jobs || !pool->stopped ||
+        !pool->idle_waiters) {
+        goto fail;
+    }
+
+    for (i = 0; i < nworkers; i++) {
+        if (uthread_create(pool_worker, pool) == -1) {
+            goto fail;
+        }
+        pool->nworkers++;
+    }
+
+    return pool;
+
+fail:
+    // Stop the workers created so far before freeing anything
+    if (pool->nworkers > 0) {
+        pool_destroy(pool);
+        return NULL;
+    }
+    free(pool->ring);
+    sem_destroy(pool->slots);
+    sem_destroy(pool->jobs);
+    sem_destroy(pool->stopped);
+    queue_destroy(pool->idle_waiters);
+    free(pool);
+    return NULL;
+}
+
+int pool_destroy(uthread_pool_t pool)
+{
+    struct uthread_pool_job stop = { NULL, NULL };
+    size_t i;
+
+    if (!pool) {
+        return -1;
+    }
+
+    pool_wait_idle(pool);
+    for (i = 0; i < pool->nworkers; i++) {
+        sem_down(pool->slots);
+        preempt_disable();
+        pool_push(pool, &stop, 1);
+        preempt_enable();
+        sem_up(pool->jobs);
+    }
+    sem_down_n(pool->stopped, pool->nworkers);
+
+    free(pool->ring);
+    sem_destroy(pool->slots);
+    sem_destroy(pool->jobs);
+    sem_destroy(pool->stopped);
+    queue_destroy(pool->idle_waiters);
+    free(pool);
+    return 0;
+}
+
+int pool_submit(uthread_pool_t pool, uthread_func_t func, void *arg)
+{
+    struct uthread_pool_job job = { func, arg };
+
+    if (!func) {
+        return -1;
+    }
+    return pool_submit_batch(pool, &job, 1);
+}
+
+int pool_submit_batch(uthread_pool_t pool, const struct uthread_pool_job *jobs,
+                      size_t n)
+{
+    size_t i;
+
+    if (!pool || !jobs) {
+        return -1;
+    }
+    for (i = 0; i < n; i++) {
+        if (!jobs[i].func) {
+            return -1;
+        }
+    }
+
+    // Queue as many jobs as fit in the queue at once, waking up as many
+    // workers with a single release
+    while (n > 0) {
+        size_t chunk = n < pool->capacity ? n : pool->capacity;
+
+        sem_down_n(pool->slots, chunk);
+        preempt_disable();
+        pool_push(pool, jobs, chunk);
+        pool->pending += chunk;
+        preempt_enable();
+        sem_up_n(pool->jobs, chunk);
+
+        jobs += chunk;
+        n -= chunk;
+    }
+    return 0;
+}
+
+int pool_wait_idle(uthread_pool_t pool)
+{
+    if (!pool) {
+        return -1;
+    }
+
+    preempt_disable();
+    if (pool->pending > 0) {
+        if (queue_enqueue(pool->idle_waiters, uthread_current()) == -1) {
+            preempt_enable();
+            return -1;
+        }
+        uthread_block();
+        return 0;
+    }
+    preempt_enable();
+    return 0;
+}
@@ -0,0 +1,91 @@
+#ifndef _POOL_H
+#define _POOL_H
+
+#include <stddef.h>
+
+#include "uthread.h"
+
+/*
+ * uthread_pool_t - Worker pool type
+ *
+ * A pool runs jobs on a fixed set of long-lived worker threads, which pull them
+ * from a bounded queue. Running a job thus costs neither a TCB nor a stack,
+ * unlike creating a thread per job.
+ */
+typedef struct uthread_pool *uthread_pool_t;
+
+/*
+ * uthread_pool_job - Job of a worker pool
+ * @func: Function to run
+ * @arg: Argument to be passed to @func
+ */
+struct uthread_pool_job {
+	uthread_func_t func;
+	void *arg;
+};
+
+/*
+ * pool_create - Create worker pool
+ * @nworkers: Number of worker threads
+ * @capacity: Number of jobs which can be queued without blocking submitters
+ *
+ * Must be called from a thread, since the workers are created right away. The
+ * workers wait for jobs until the pool is destroyed, so a pool must be
+ * destroyed for uthread_run() to return.
+ *
+ * Return: Pointer to initialized pool. NULL if @nworkers or @capacity is 0, or
+ * in case of failure (memory allocation, called outside of uthread_run()).
+ */
+uthread_pool_t pool_create(size_t nworkers, size_t capacity);
+
+/*
+ * pool_destroy - Deallocate a worker pool
+ * @pool: Pool to deallocate
+ *
+ * Wait for all the submitted jobs to be done, then stop the workers.
+ *
+ * Return: -1 if @pool is NULL. 0 if @pool was successfully destroyed.
+ */
+int pool_destroy(uthread_pool_t pool);
+
+/*
+ * pool_submit - Submit a job to a worker pool
+ * @pool: Pool to run the job
+ * @func: Function to run
+ * @arg: Argument to be passed to @func
+ *
+ * Queue @func to be run by one of the workers of @pool, in FIFO order with the
+ * other jobs. Block the caller thread while the queue of @pool is full.
+ *
+ * Return: -1 if @pool or @func is NULL. 0 if the job was successfully queued.
+ */
+int pool_submit(uthread_pool_t pool, uthread_func_t func, void *arg);
+
+/*
+ * pool_submit_batch - Submit several jobs to a worker pool at once
+ * @pool: Pool to run the jobs
+ * @jobs: Array of jobs
+ * @n: Number of jobs in @jobs
+ *
+ * Same as calling pool_submit() on every job of @jobs in order, but queue slots
+ * are reserved, and workers woken up, for as many jobs as fit at once.
+ *
+ * Return: -1 if @pool or @jobs is NULL, or if a job has no function (in which
+ * case no job is queued). 0 if the jobs were successfully queued.
+ */
+int pool_submit_batch(uthread_pool_t pool, const struct uthread_pool_job *jobs,
+		      size_t n);
+
+/*
+ * pool_wait_idle - Wait for a worker pool to be idle
+ * @pool: Pool to wait on
+ *
+ * Block the caller thread until all the jobs submitted to @pool have been run.
+ * Returns right away if there are none.
+ *
+ * Return: -1 if @pool is NULL, or in case of failure when queueing the caller.
+ * 0 once @pool is idle.
+ */
+int pool_wait_idle(uthread_pool_t pool);
+
+#endif /* _POOL_H */
@@ -16,14 +16,42 @@
 #define HZ 100
 #define start_time 0
 
+/*
+ * Whether the timer is running. Without it, there is no signal to mask, so
+ * preempt_disable() and preempt_enable() skip the system call.
+ */
+static bool preempt_active;
+
+#ifdef UTHREAD_LATENCY
+/*
+ * Tell the profiler how long ago the timer expired. The timer was re-armed
+ * with a full period right then, so the elapsed time is what is missing from
+ * the period (in process time, as the timer counts).
+ */
+static void alarm_late(void)
+{
+	struct itimerval timer;
+	int64_t late;
+
+	if (getitimer(ITIMER_VIRTUAL, &timer) == -1)
+		return;
+
+	late = (int64_t)(1000000 / HZ) - timer.it_value.tv_sec * 1000000 -
+	       timer.it_value.tv_usec;
+	uthread_latency_alarm(late > 0 ? (uint64_t)late * 1000 : 0);
+}
+#endif
+
 /* 
  * The signal handler for the virtual alarm signal.
- * It simply calls uthread_yield to yield the CPU from the current thread.
+ * It simply calls uthread_preempt to yield the CPU from the current thread.
  */
 void alarm_handler(int sig) 
 {
     (void) sig;
-	uthread_yield();
+	UTHREAD_TRACE_EVENT(TRACE_PREEMPT, uthread_current(), 0);
+	UTHREAD_LATENCY_EVENT(alarm_late());
+	uthread_preempt();
 }
 
 /*
@@ -31,10 +59,14 @@ void alarm_handler(int sig)
  */
 void preempt_disable(void)
 {
+	if (!preempt_active)
+		return;
+
 	sigset_t block_alarm;
 	sigemptyset(&block_alarm);
 	sigaddset(&block_alarm, SIGVTALRM);
 	sigprocmask(SIG_BLOCK, &block_alarm, NULL);
+	UTHREAD_LATENCY_EVENT(uthread_latency_masked(__builtin_return_address(0)));
 }
 
 /*
@@ -42,6 +74,11 @@ void preempt_disable(void)
  */
 void preempt_enable(void)
 {
+	if (!preempt_active)
+		return;
+
+	UTHREAD_LATENCY_EVENT(uthread_latency_unmasked());
+
 	sigset_t unblock_alarm;
 	sigemptyset(&unblock_alarm);
 	sigaddset(&unblock_alarm, SIGVTALRM);
@@ -53,8 +90,10 @@ void preempt_enable(void)
  */
 void preempt_start(bool preempt)
 {
+	if (!preempt)
+		return;
+
 	// Set up signal
-    (void) preempt;
 	struct sigaction sa;
 	sa.sa_handler = alarm_handler;
 	sigemptyset(&sa.sa_mask);
@@ -67,6 +106,7 @@ void preempt_start(bool preempt)
     timer.it_interval.tv_usec = 1000000 / HZ;
 	timer.it_value.tv_sec = start_time;
     timer.it_value.tv_usec = 1000000 / HZ;
+	preempt_active = true;
 	setitimer(ITIMER_VIRTUAL, &timer, NULL);
 }
 
@@ -77,11 +117,20 @@ void preempt_stop(void)
 {
 	setitimer(ITIMER_VIRTUAL, NULL, NULL);	//Stops timer
 	
-	// Resets the signal handler for SIGVTALRM to the default handler.
+	if (!preempt_active)
+		return;
+
+	// Discard a pending alarm, and leave the signal unmasked for the next run
 	struct sigaction sa;
-	sa.sa_handler = SIG_DFL;
+	sa.sa_handler = SIG_IGN;
 	sigemptyset(&sa.sa_mask);
 	sa.sa_flags = 0;
+	sigaction(SIGVTALRM, &sa, NULL);
+	preempt_enable();
+	preempt_active = false;
+
+	// Resets the signal handler for SIGVTALRM to the default handler.
+	sa.sa_handler = SIG_DFL;
 	if(sigaction(SIGVTALRM, &sa, NULL)) {
 		return;
 	}
@@ -10,8 +10,15 @@
 /**
  * Private context API
  */
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
 #include <ucontext.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
+#include "queue.h"
 #include "uthread.h"
 
 /*
@@ -23,8 +30,22 @@
  * Such a context is initialized for the first time when creating a thread with
  * uthread_ctx_init(). Once initialized, it can be switched to with
  * uthread_ctx_switch().
+ *
+ * On x86-64, the context only holds the saved stack pointer: the registers
+ * preserved across calls are pushed on the thread's own stack when switching
+ * away from it. Other architectures fall back to a full ucontext_t.
  */
+#if defined(__x86_64__)
+#define UTHREAD_CTX_COMPACT
+typedef struct {
+	void *sp;	/* Stack pointer, at the saved registers */
+} uthread_ctx_t;
+#else
 typedef ucontext_t uthread_ctx_t;
+#endif
+
+/* Default size of the stack for a thread (in bytes) */
+#define UTHREAD_STACK_SIZE 32768
 
 /*
  * uthread_ctx_switch - Switch between two execution contexts
@@ -36,32 +57,107 @@ void uthread_ctx_switch(uthread_ctx_t *prev, uthread_ctx_t *next);
 
 /*
  * uthread_ctx_alloc_stack - Allocate stack segment
+ * @size: Size of the stack segment (in bytes)
+ *
+ * The segment comes from the stack arena if it has room for it, from the pool
+ * of freed stacks, or from malloc() otherwise. If stack profiling is enabled,
+ * the segment is painted with uthread_stack_paint().
  *
  * Return: Pointer to the top of a valid stack segment, or NULL in case of
  * failure
  */
-void *uthread_ctx_alloc_stack(void);
+void *uthread_ctx_alloc_stack(size_t size);
 
 /*
  * uthread_ctx_destroy_stack - Deallocate stack segment
  * @top_of_stack: Address of stack to deallocate
+ * @size: Size of the stack segment (in bytes)
+ *
+ * A few stacks of each of the most common sizes are kept in a pool, from which
+ * uthread_ctx_alloc_stack() draws before calling malloc().
  */
-void uthread_ctx_destroy_stack(void *top_of_stack);
+void uthread_ctx_destroy_stack(void *top_of_stack, size_t size);
 
 /*
  * uthread_ctx_init - Initialize a thread's execution context
  * @uctx: Pointer to thread context to initialize
  * @top_of_stack: Pointer to the top of a valid stack segment, as allocated by
  *	uthread_ctx_alloc_stack()
+ * @size: Size of the stack segment (in bytes)
  * @func: Function to be executed by the thread
  * @arg: Argument to pass to the thread
  *
  * Return: 0 if @uctx was properly initialized, or -1 in case of failure
  */
-int uthread_ctx_init(uthread_ctx_t *uctx, void *top_of_stack,
+int uthread_ctx_init(uthread_ctx_t *uctx, void *top_of_stack, size_t size,
 					 uthread_func_t func, void *arg);
 
 
+/**
+ * Private stack profiling API
+ */
+
+/*
+ * uthread_stack_profiling - Check whether stack profiling is enabled
+ *
+ * Return: True if newly allocated stacks should be painted
+ */
+bool uthread_stack_profiling(void);
+
+/*
+ * uthread_stack_paint - Paint a stack segment with the canary pattern
+ * @stack: Stack segment
+ * @size: Size of @stack (in bytes)
+ */
+void uthread_stack_paint(void *stack, size_t size);
+
+/*
+ * uthread_stack_record - Measure and record the high-water mark of a stack
+ * @func: Entry function of the thread which ran on @stack
+ * @stack: Painted stack segment
+ * @size: Size of @stack (in bytes)
+ *
+ * Can be called by the thread running on @stack itself, as the scan starts from
+ * the bottom of the stack.
+ */
+void uthread_stack_record(uthread_func_t func, void *stack, size_t size);
+
+/*
+ * uthread_stack_size - Pick the stack size of a new thread
+ * @func: Entry function of the new thread
+ *
+ * Return: The default stack size (UTHREAD_STACK_SIZE, or the usable size of the
+ * stack arena slots), or the size class picked for @func if automatic sizing is
+ * enabled and enough of its threads were profiled
+ */
+size_t uthread_stack_size(uthread_func_t func);
+
+/*
+ * uthread_arena_stack_size - Get the usable size of the stack arena slots
+ *
+ * Return: Size of a slot minus its guard page, or 0 if there is no arena
+ */
+size_t uthread_arena_stack_size(void);
+
+/*
+ * uthread_arena_stack_alloc - Allocate a stack from the arena
+ * @size: Size of the stack (in bytes)
+ *
+ * Return: Pointer to the top of a stack segment of @size bytes, or NULL if
+ * there is no arena, if @size does not fit in a slot or if all the slots are
+ * in use
+ */
+void *uthread_arena_stack_alloc(size_t size);
+
+/*
+ * uthread_arena_stack_free - Give a stack back to the arena
+ * @stack: Stack segment
+ *
+ * Return: True if @stack came from the arena, false otherwise
+ */
+bool uthread_arena_stack_free(void *stack);
+
+
 /**
  * Private preemption API
  */
@@ -97,6 +193,114 @@ void preempt_enable(void);
 void preempt_disable(void);
 
 
+/**
+ * Private clock API
+ */
+
+/*
+ * uthread_clock - Read a cheap timestamp
+ *
+ * On x86, this reads the CPU timestamp counter and never enters the kernel.
+ * Elsewhere, it falls back to CLOCK_MONOTONIC in nanoseconds.
+ *
+ * Return: Current timestamp, in ticks. Only differences between timestamps are
+ * meaningful, and they can be converted with uthread_clock_ns().
+ */
+static inline uint64_t uthread_clock(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+/*
+ * uthread_clock_init - Calibrate the clock
+ *
+ * Measures the rate of the timestamp counter against CLOCK_MONOTONIC, spinning
+ * for a millisecond. Called by uthread_run(), so that uthread_clock_ns() never
+ * waits. Calling this function more than once has no effect.
+ */
+void uthread_clock_init(void);
+
+/*
+ * uthread_clock_ns - Convert a number of clock ticks into nanoseconds
+ * @ticks: Difference between two values returned by uthread_clock()
+ *
+ * Calibrates the clock with uthread_clock_init() if it was not already.
+ *
+ * Return: @ticks expressed in nanoseconds
+ */
+uint64_t uthread_clock_ns(uint64_t ticks);
+
+/*
+ * uthread_monotonic_ns - Read CLOCK_MONOTONIC
+ *
+ * Return: Current CLOCK_MONOTONIC time, in nanoseconds
+ */
+uint64_t uthread_monotonic_ns(void);
+
+
+/**
+ * Private timer API
+ */
+
+/*
+ * uthread_timer - Pending timer
+ * @deadline: CLOCK_MONOTONIC time at which the timer fires, in nanoseconds
+ * @func: Function called once the deadline has passed
+ * @index: Position in the heap of pending timers, managed by the timer API
+ *
+ * Meant to be embedded in the structure waiting for the deadline, which @func
+ * can retrieve from the timer's address.
+ */
+struct uthread_timer {
+	uint64_t deadline;
+	void (*func)(struct uthread_timer *timer);
+	size_t index;
+};
+
+/*
+ * uthread_timer_add - Arm a timer
+ * @timer: Timer, with its deadline and function set
+ *
+ * Must be called with preemption disabled. The timer fires at the first
+ * scheduling point past its deadline, and is disarmed before its function is
+ * called.
+ *
+ * Return: 0 in case of success, -1 in case of failure (memory allocation)
+ */
+int uthread_timer_add(struct uthread_timer *timer);
+
+/*
+ * uthread_timer_cancel - Disarm a timer which has not fired yet
+ * @timer: Armed timer
+ *
+ * Must be called with preemption disabled.
+ */
+void uthread_timer_cancel(struct uthread_timer *timer);
+
+/*
+ * uthread_timer_expire - Fire the timers whose deadline has passed
+ *
+ * Must only be called by the scheduler, with preemption disabled. The timer
+ * functions therefore run with preemption disabled.
+ */
+void uthread_timer_expire(void);
+
+/*
+ * uthread_timer_timeout - Get the time left before the next deadline
+ *
+ * Return: Nanoseconds until the earliest deadline (0 if already passed), or -1
+ * if no timer is armed
+ */
+int64_t uthread_timer_timeout(void);
+
+
 /**
  * Private uthread API
  */
@@ -114,6 +318,121 @@ struct uthread_tcb;
  */
 struct uthread_tcb *uthread_current(void);
 
+/*
+ * uthread_id - Get thread identifier
+ * @uthread: TCB of thread
+ *
+ * Return: Identifier of @uthread, 0 being the idle thread
+ */
+uint64_t uthread_id(struct uthread_tcb *uthread);
+
+struct semaphore;
+struct sem_waiter;
+
+/*
+ * uthread_locks - Locks of a thread, for priority inheritance
+ * @held: Lock-mode semaphores held by the thread, chained by the semaphores
+ * @waiting: Registrations of the thread on the semaphores it is blocked on, if
+ * any of them is a lock: one for sem_down(), one per semaphore for
+ * uthread_select()
+ * @nr_waiting: Number of registrations in @waiting
+ */
+struct uthread_locks {
+	struct semaphore *held;
+	struct sem_waiter *waiting;
+	size_t nr_waiting;
+};
+
+/*
+ * uthread_locks - Get the locks of a thread
+ * @uthread: Thread
+ */
+struct uthread_locks *uthread_locks(struct uthread_tcb *uthread);
+
+/*
+ * uthread_inherit_priority - Set the priority a thread inherits
+ * @uthread: Thread
+ * @priority: Highest priority of the threads waiting on locks held by
+ * @uthread, INT_MIN if none
+ *
+ * The priority of @uthread becomes the highest of its own and @priority. If
+ * @uthread is runnable, the policy is told, so that it moves it accordingly.
+ * Must be called with preemption disabled.
+ */
+void uthread_inherit_priority(struct uthread_tcb *uthread, int priority);
+
+/*
+ * uthread_lock_priority_changed - Pass on the new priority of a thread
+ * @uthread: Thread whose own priority changed
+ *
+ * If @uthread is blocked on locks, move it among their waiters, and recompute
+ * the priority their owners inherit, and so on along the chains. Must be called
+ * with preemption disabled.
+ */
+void uthread_lock_priority_changed(struct uthread_tcb *uthread);
+
+/*
+ * uthread_blocked_since - Get the time at which a blocked thread blocked
+ * @uthread: Blocked thread
+ *
+ * Return: uthread_clock() timestamp of the call to uthread_block()
+ */
+uint64_t uthread_blocked_since(struct uthread_tcb *uthread);
+
+/*
+ * uthread_alloc_arena - Per-thread arena of uthread_arena_alloc()
+ * @next: Next free byte of the current chunk
+ * @end: End of the current chunk
+ * @chunks: Chunks of the arena, the current one first
+ */
+struct uthread_alloc_arena {
+	char *next;
+	char *end;
+	struct alloc_chunk *chunks;
+};
+
+/*
+ * uthread_current_arena - Get the arena of the currently running thread
+ *
+ * Return: Arena of the current thread, NULL if the scheduler is not running
+ */
+struct uthread_alloc_arena *uthread_current_arena(void);
+
+/*
+ * uthread_alloc_release - Release all the chunks of an arena
+ * @arena: Arena, left empty
+ *
+ * Must be called with preemption disabled.
+ */
+void uthread_alloc_release(struct uthread_alloc_arena *arena);
+
+/*
+ * uthread_nr_ready - Get the number of runnable items
+ *
+ * Return: Number of threads and tasks held by the scheduler policy, waiting
+ * for their turn
+ */
+size_t uthread_nr_ready(void);
+
+/*
+ * uthread_local - Get the per-thread data of library modules
+ *
+ * Return: Pointer to a slot of the currently running thread, which the library
+ * modules can use to find their own state (e.g., the generator a thread runs).
+ * The slot is NULL when a thread is created.
+ */
+void **uthread_local(void);
+
+/*
+ * uthread_link - Get the wait list link of a thread
+ * @uthread: TCB of thread
+ *
+ * Return: Pointer to a link of @uthread, with which primitives can chain their
+ * blocked threads into a list without allocating. A thread can only be on one
+ * such list at a time, while it is blocked.
+ */
+struct uthread_tcb **uthread_link(struct uthread_tcb *uthread);
+
 /*
  * uthread_block - Block currently running thread
  */
@@ -122,7 +441,222 @@ void uthread_block(void);
 /*
  * uthread_unblock - Unblock thread
  * @uthread: TCB of thread to unblock
+ *
+ * Must be called with preemption disabled.
  */
 void uthread_unblock(struct uthread_tcb *uthread);
 
+/*
+ * uthread_unblock_all - Unblock a queue of threads
+ * @waiters: Queue of TCBs of blocked threads, oldest first
+ *
+ * Same as calling uthread_unblock() on every thread of @waiters in order, but
+ * the whole queue is spliced onto the ready queue in one operation. @waiters is
+ * left empty.
+ *
+ * Must be called with preemption disabled.
+ */
+void uthread_unblock_all(queue_t waiters);
+
+/*
+ * uthread_preempt - Forcefully yield currently running thread
+ *
+ * Same as uthread_yield(), but meant to be called from the preemption timer
+ * handler so that involuntary context switches can be accounted separately.
+ */
+void uthread_preempt(void);
+
+
+
+/**
+ * Private injection API
+ */
+
+/*
+ * uthread_inject - Node of the injection queue
+ * @next: Next node in the queue, managed by the queue
+ * @func: Function called by the scheduler on the node once dequeued
+ *
+ * Meant to be embedded in the structure that needs attention from the
+ * scheduler, which @func can retrieve from the node's address. A node must not
+ * be injected again before @func has been called.
+ */
+struct uthread_inject {
+	_Atomic(struct uthread_inject *) next;
+	void (*func)(struct uthread_inject *node);
+};
+
+/*
+ * uthread_inject_init - Initialize the injection queue and its doorbell
+ *
+ * Calling this function more than once has no effect.
+ *
+ * Return: 0 (if the doorbell cannot be created, the idle thread polls the
+ * queue instead of sleeping)
+ */
+int uthread_inject_init(void);
+
+/*
+ * uthread_inject - Hand a node over to the scheduler
+ * @node: Node to inject
+ *
+ * Lock-free and async-signal-safe: can be called from any kernel thread or
+ * signal handler, and wakes the idle thread up if it is sleeping. The node's
+ * function is called by the scheduler at its next scheduling point.
+ */
+void uthread_inject(struct uthread_inject *node);
+
+/*
+ * uthread_inject_pending - Check whether nodes are waiting to be drained
+ *
+ * Return: True if the injection queue is not empty
+ */
+bool uthread_inject_pending(void);
+
+/*
+ * uthread_inject_drain - Call the function of every injected node
+ *
+ * Must only be called by the scheduler, with preemption disabled. The node
+ * functions therefore run with preemption disabled.
+ */
+void uthread_inject_drain(void);
+
+/*
+ * uthread_inject_wait - Sleep until nodes are injected, then drain them
+ * @timeout: Longest time to sleep, in nanoseconds, or -1 to sleep until nodes
+ * are injected
+ *
+ * Meant for the idle thread, when no thread is ready to run. Also returns early
+ * once a file descriptor threads wait on with uthread_io_wait() is ready.
+ */
+void uthread_inject_wait(int64_t timeout);
+
+/*
+ * Private I/O API
+ */
+
+/*
+ * uthread_io_fd - Get the file descriptor signaling I/O readiness
+ *
+ * Return: File descriptor which is readable once uthread_io_poll() has threads
+ * to wake up, -1 if no thread waits on a file descriptor
+ */
+int uthread_io_fd(void);
+
+/*
+ * uthread_io_poll - Wake up the threads whose file descriptor is ready
+ *
+ * Must only be called by the scheduler, with preemption disabled. Never
+ * blocks.
+ */
+void uthread_io_poll(void);
+
+/*
+ * uthread_io_check - Call uthread_io_poll() every so often
+ *
+ * Meant for the scheduling points of running threads, so that threads waiting
+ * on file descriptors do not wait for the ready queue to be empty.
+ */
+void uthread_io_check(void);
+
+
+/**
+ * Private trace API
+ */
+
+/*
+ * uthread_trace_type - Type of a recorded scheduling event
+ */
+enum uthread_trace_type {
+	TRACE_CREATE,	/* Thread was created */
+	TRACE_SWITCH,	/* Thread starts running */
+	TRACE_YIELD,	/* Thread yields voluntarily */
+	TRACE_PREEMPT,	/* Thread is preempted by the timer */
+	TRACE_BLOCK,	/* Thread blocks */
+	TRACE_UNBLOCK,	/* Thread is unblocked */
+	TRACE_EXIT,	/* Thread exits */
+	TRACE_SEM_DOWN,	/* Thread takes a semaphore, whose address is the argument */
+	TRACE_SEM_UP,	/* Thread releases a semaphore, whose address is the argument */
+};
+
+#ifdef UTHREAD_TRACE
+/* Whether events are currently being recorded */
+extern bool uthread_trace_enabled;
+
+/*
+ * uthread_trace_record - Record an event in the trace ring buffer
+ * @type: Type of event
+ * @uthread: TCB of the thread the event is about
+ * @arg: Argument specific to @type
+ *
+ * Safe to call from the preemption timer handler.
+ */
+void uthread_trace_record(enum uthread_trace_type type,
+			  struct uthread_tcb *uthread, uintptr_t arg);
+
+/*
+ * UTHREAD_TRACE_EVENT - Record an event if tracing is started
+ *
+ * The arguments are only evaluated if tracing is started, so that a stopped
+ * trace costs a single branch.
+ */
+#define UTHREAD_TRACE_EVENT(type, uthread, arg)				\
+do {									\
+	if (__builtin_expect(uthread_trace_enabled, 0))			\
+		uthread_trace_record(type, uthread, (uintptr_t)(arg));	\
+} while (0)
+#else
+#define UTHREAD_TRACE_EVENT(type, uthread, arg) do { } while (0)
+#endif
+
+
+/**
+ * Private latency profiling API
+ */
+
+#ifdef UTHREAD_LATENCY
+/* Whether preemption latency is currently being profiled */
+extern bool uthread_latency_enabled;
+
+/*
+ * uthread_latency_masked - Note that the preemption signal is now masked
+ * @site: Return address of preempt_disable()
+ *
+ * Starts a masked region, unless one is already in progress. Must be called
+ * with the signal masked.
+ */
+void uthread_latency_masked(void *site);
+
+/*
+ * uthread_latency_unmasked - Record the masked region in progress, if any
+ *
+ * Must be called while the signal is still masked.
+ */
+void uthread_latency_unmasked(void);
+
+/*
+ * uthread_latency_alarm - Note that the preemption timer handler runs
+ * @late_ns: Time elapsed since the timer expired
+ */
+void uthread_latency_alarm(uint64_t late_ns);
+
+/*
+ * uthread_latency_switch - Record the delay of the last alarm, if any
+ *
+ * Called when the scheduler switches away from a preempted thread.
+ */
+void uthread_latency_switch(void);
+
+/*
+ * UTHREAD_LATENCY_EVENT - Call a profiling hook if profiling is started
+ */
+#define UTHREAD_LATENCY_EVENT(call)					\
+do {									\
+	if (__builtin_expect(uthread_latency_enabled, 0))		\
+		call;							\
+} while (0)
+#else
+#define UTHREAD_LATENCY_EVENT(call) do { } while (0)
+#endif
+
 #endif /* _UTHREAD_PRIVATE_H */
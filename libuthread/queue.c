@@ -13,19 +13,45 @@ typedef struct node {
     struct node *next;
 } node_t;
 
+/* Initial capacity of a ring buffer queue, must be a power of two */
+#define RING_INITIAL_CAPACITY 16
+
+/**
+ * Position of an ongoing queue_iterate() on a ring buffer queue, so that
+ * deletions can shift it along with the items. Nested iterations are chained.
+ */
+struct ring_iter {
+    int pos;
+    struct ring_iter *outer;
+};
+
 /**
  * Queue structure with pointer to the head and tail of queue, and the number of items in queue
+ *
+ * A queue is either a singly linked list (head and tail), or a circular buffer
+ * (ring) whose capacity is a power of two and which grows by doubling.
  */
 struct queue {
     int size;
     node_t *head;
     node_t *tail;
+    void **ring;                // Items of a ring buffer queue, NULL for a list
+    int capacity;               // Number of slots in ring
+    int first;                  // Slot of the oldest item in ring
+    struct ring_iter *iter;     // Innermost ongoing iteration
 };
 
+/**
+ * Slot of the @i-th oldest item of a ring buffer queue
+ */
+static inline int ring_slot(queue_t queue, int i) {
+    return (queue->first + i) & (queue->capacity - 1);
+}
+
 /**
  * Create a new empty queue and return its address
  */
-queue_t queue_create(void) {
+static queue_t queue_alloc(void) {
     queue_t new_queue = (queue_t) malloc(sizeof(struct queue));
 
     if (new_queue == NULL) {
@@ -35,6 +61,40 @@ queue_t queue_create(void) {
     new_queue->size = 0;
     new_queue->head = NULL;
     new_queue->tail = NULL;
+    new_queue->ring = NULL;
+    new_queue->capacity = 0;
+    new_queue->first = 0;
+    new_queue->iter = NULL;
+    return new_queue;
+}
+
+/**
+ * Create a new empty queue, backed by a ring buffer if built with QUEUE_RING
+ */
+queue_t queue_create(void) {
+#ifdef QUEUE_RING
+    return queue_create_ring();
+#else
+    return queue_alloc();
+#endif
+}
+
+/**
+ * Create a new empty queue backed by a ring buffer
+ */
+queue_t queue_create_ring(void) {
+    queue_t new_queue = queue_alloc();
+
+    if (new_queue == NULL) {
+        return NULL;
+    }
+
+    new_queue->ring = malloc(RING_INITIAL_CAPACITY * sizeof(void *));
+    if (new_queue->ring == NULL) {
+        free(new_queue);
+        return NULL;
+    }
+    new_queue->capacity = RING_INITIAL_CAPACITY;
     return new_queue;
 }
 
@@ -45,11 +105,49 @@ int queue_destroy(queue_t queue) {
     if (queue == NULL || queue->size != 0) {
         return -1;
     } else {
+        free(queue->ring);
         free(queue);
         return 0;
     }
 }
 
+/**
+ * Double the capacity of a ring buffer queue, unwrapping its items
+ */
+static int ring_grow(queue_t queue) {
+    void **ring = malloc(2 * queue->capacity * sizeof(void *));
+
+    if (ring == NULL) {
+        return -1;
+    }
+
+    for (int i = 0; i < queue->size; i++) {
+        ring[i] = queue->ring[ring_slot(queue, i)];
+    }
+    free(queue->ring);
+    queue->ring = ring;
+    queue->capacity *= 2;
+    queue->first = 0;
+    return 0;
+}
+
+/**
+ * Remove the @i-th oldest item of a ring buffer queue, shifting the newer items
+ * and the ongoing iterations accordingly
+ */
+static void ring_remove(queue_t queue, int i) {
+    for (int j = i; j < queue->size - 1; j++) {
+        queue->ring[ring_slot(queue, j)] = queue->ring[ring_slot(queue, j + 1)];
+    }
+    --queue->size;
+
+    for (struct ring_iter *iter = queue->iter; iter != NULL; iter = iter->outer) {
+        if (i <= iter->pos) {
+            --iter->pos;
+        }
+    }
+}
+
 /**
  * Enqueue a new data item into the queue
  */
@@ -58,12 +156,21 @@ int queue_enqueue(queue_t queue, void *data) {
         return -1;
     }
 
+    if (queue->ring != NULL) {
+        if (queue->size == queue->capacity && ring_grow(queue) == -1) {
+            return -1;
+        }
+        queue->ring[ring_slot(queue, queue->size)] = data;
+        ++queue->size;
+        return 0;
+    }
+
     node_t *new_node = (node_t *) malloc(sizeof(node_t));
-    new_node->data = data;
-    new_node->next = NULL;
     if (new_node == NULL) {
         return -1;
     }
+    new_node->data = data;
+    new_node->next = NULL;
 
     if (queue->size == 0) {
         queue->head = new_node;
@@ -83,6 +190,19 @@ int queue_dequeue(queue_t queue, void **data) {
     if (queue == NULL || data == NULL || queue->size == 0) {
         return -1;
     }
+
+    if (queue->ring != NULL) {
+        *data = queue->ring[queue->first];
+        if (queue->iter != NULL) {
+            // Let ongoing iterations know the oldest item went away
+            ring_remove(queue, 0);
+            return 0;
+        }
+        queue->first = ring_slot(queue, 1);
+        --queue->size;
+        return 0;
+    }
+
     node_t *cur = queue->head;
     *data = cur->data;
     queue->head = cur->next;
@@ -95,6 +215,22 @@ int queue_dequeue(queue_t queue, void **data) {
     return 0;
 }
 
+/**
+ * Get the oldest data item without removing it
+ */
+int queue_peek(queue_t queue, void **data) {
+    if (queue == NULL || data == NULL || queue->size == 0) {
+        return -1;
+    }
+
+    if (queue->ring != NULL) {
+        *data = queue->ring[queue->first];
+    } else {
+        *data = queue->head->data;
+    }
+    return 0;
+}
+
 /**
  * Delete a specific data item that first appeared(oldest) in the queue
  */
@@ -103,6 +239,16 @@ int queue_delete(queue_t queue, void *data) {
         return -1;
     }
 
+    if (queue->ring != NULL) {
+        for (int i = 0; i < queue->size; i++) {
+            if (queue->ring[ring_slot(queue, i)] == data) {
+                ring_remove(queue, i);
+                return 0;
+            }
+        }
+        return -1;
+    }
+
     node_t *cur = queue->head;
     node_t *prev = NULL;
     int match = 0;
@@ -145,6 +291,18 @@ int queue_iterate(queue_t queue, queue_func_t func) {
         return -1;
     }
 
+    if (queue->ring != NULL) {
+        // Deleted items shift the position back, so that none is skipped
+        struct ring_iter iter = { 0, queue->iter };
+
+        queue->iter = &iter;
+        for (; iter.pos < queue->size; iter.pos++) {
+            func(queue, queue->ring[ring_slot(queue, iter.pos)]);
+        }
+        queue->iter = iter.outer;
+        return 0;
+    }
+
     node_t *cur = queue->head;
     node_t *prev = NULL;
     node_t *next = NULL;
@@ -176,3 +334,128 @@ int queue_length(queue_t queue) {
     }
     return queue->size;
 }
+
+/**
+ * Enqueue @count data items at once, or none of them in case of failure
+ */
+int queue_enqueue_batch(queue_t queue, void **data, int count) {
+    if (queue == NULL || data == NULL || count < 0) {
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        if (data[i] == NULL) {
+            return -1;
+        }
+    }
+
+    if (queue->ring != NULL) {
+        while (queue->size + count > queue->capacity) {
+            if (ring_grow(queue) == -1) {
+                return -1;
+            }
+        }
+        for (int i = 0; i < count; i++) {
+            queue->ring[ring_slot(queue, queue->size + i)] = data[i];
+        }
+        queue->size += count;
+        return 0;
+    }
+
+    // Build the chain of new nodes aside, then link it in one step
+    node_t *head = NULL;
+    node_t *tail = NULL;
+    for (int i = 0; i < count; i++) {
+        node_t *new_node = (node_t *) malloc(sizeof(node_t));
+        if (new_node == NULL) {
+            while (head != NULL) {
+                node_t *next = head->next;
+                free(head);
+                head = next;
+            }
+            return -1;
+        }
+        new_node->data = data[i];
+        new_node->next = NULL;
+        if (head == NULL) {
+            head = new_node;
+        } else {
+            tail->next = new_node;
+        }
+        tail = new_node;
+    }
+
+    if (count > 0) {
+        if (queue->size == 0) {
+            queue->head = head;
+        } else {
+            queue->tail->next = head;
+        }
+        queue->tail = tail;
+        queue->size += count;
+    }
+    return 0;
+}
+
+/**
+ * Dequeue up to @max of the oldest data items at once
+ */
+int queue_dequeue_batch(queue_t queue, void **data, int max) {
+    if (queue == NULL || data == NULL || max < 0) {
+        return -1;
+    }
+
+    int count = queue->size < max ? queue->size : max;
+
+    if (queue->ring != NULL && queue->iter == NULL) {
+        for (int i = 0; i < count; i++) {
+            data[i] = queue->ring[ring_slot(queue, i)];
+        }
+        queue->first = ring_slot(queue, count);
+        queue->size -= count;
+        return count;
+    }
+
+    for (int i = 0; i < count; i++) {
+        queue_dequeue(queue, &data[i]);
+    }
+    return count;
+}
+
+/**
+ * Move all the items of @src to the tail of @dst, which is O(1) between two
+ * linked list queues
+ */
+int queue_splice(queue_t dst, queue_t src) {
+    if (dst == NULL || src == NULL || dst == src) {
+        return -1;
+    }
+    if (src->size == 0) {
+        return 0;
+    }
+
+    if (dst->ring == NULL && src->ring == NULL) {
+        if (dst->size == 0) {
+            dst->head = src->head;
+        } else {
+            dst->tail->next = src->head;
+        }
+        dst->tail = src->tail;
+        dst->size += src->size;
+
+        src->head = NULL;
+        src->tail = NULL;
+        src->size = 0;
+        return 0;
+    }
+
+    // At least one of the queues is a ring buffer, so items must be copied
+    void *data;
+    while (src->size > 0) {
+        if (queue_enqueue(dst, src->ring != NULL ? src->ring[src->first]
+                                                 : src->head->data) == -1) {
+            return -1;
+        }
+        queue_dequeue(src, &data);
+    }
+    return 0;
+}
@@ -8,7 +8,8 @@
  * other.  When dequeueing, the queue must returned the oldest enqueued item
  * first and so on.
  *
- * Apart from delete and iterate operations, all operations should be O(1).
+ * Apart from delete, iterate and batch operations, all operations should be
+ * O(1).
  */
 typedef struct queue* queue_t;
 
@@ -22,6 +23,22 @@ typedef struct queue* queue_t;
  */
 queue_t queue_create(void);
 
+/*
+ * queue_create_ring - Allocate an empty queue backed by a ring buffer
+ *
+ * Same as queue_create(), but the items are stored in a circular array which
+ * doubles in size when full, instead of a linked list. Enqueueing and
+ * dequeueing then neither allocate memory (apart from growing) nor chase
+ * pointers. The returned queue supports the whole queue API.
+ *
+ * If the library is built with QUEUE_RING defined, queue_create() also returns
+ * such a queue.
+ *
+ * Return: Pointer to new empty queue. NULL in case of failure when allocating
+ * the new queue.
+ */
+queue_t queue_create_ring(void);
+
 /*
  * queue_destroy - Deallocate a queue
  * @queue: Queue to deallocate
@@ -58,6 +75,66 @@ int queue_enqueue(queue_t queue, void *data);
  */
 int queue_dequeue(queue_t queue, void **data);
 
+/*
+ * queue_peek - Get oldest data item
+ * @queue: Queue in which to look
+ * @data: Address of data pointer where item is received
+ *
+ * Assign the oldest item of queue @queue to @data, without removing it.
+ *
+ * Return: -1 if @queue or @data are NULL, or if the queue is empty. 0 if @data
+ * was set with the oldest item available in @queue.
+ */
+int queue_peek(queue_t queue, void **data);
+
+/*
+ * queue_enqueue_batch - Enqueue several data items
+ * @queue: Queue in which to enqueue items
+ * @data: Array of addresses of data items to enqueue, oldest first
+ * @count: Number of items in @data
+ *
+ * Enqueue the @count addresses contained in @data in the queue @queue, as if
+ * queue_enqueue() was called on each of them in order, but linking them into
+ * @queue in a single step.
+ *
+ * Return: -1 if @queue or @data are NULL, if @count is negative, if any item of
+ * @data is NULL, or in case of memory allocation error when enqueing (in which
+ * case no item was enqueued). 0 if all the items were successfully enqueued.
+ */
+int queue_enqueue_batch(queue_t queue, void **data, int count);
+
+/*
+ * queue_dequeue_batch - Dequeue several data items
+ * @queue: Queue in which to dequeue items
+ * @data: Array receiving the dequeued items, oldest first
+ * @max: Maximum number of items to dequeue, ie size of @data
+ *
+ * Remove up to @max of the oldest items of queue @queue and assign them to
+ * @data, as if queue_dequeue() was called repeatedly.
+ *
+ * Return: -1 if @queue or @data are NULL, or if @max is negative. Number of
+ * items assigned to @data otherwise, 0 if @queue is empty.
+ */
+int queue_dequeue_batch(queue_t queue, void **data, int max);
+
+/*
+ * queue_splice - Concatenate two queues
+ * @dst: Queue to which items are appended
+ * @src: Queue whose items are moved
+ *
+ * Move all the items of queue @src, in order, to the tail of queue @dst. @src
+ * is left empty but is not deallocated. When both queues were created with
+ * queue_create() (and the library was not built with QUEUE_RING), this is
+ * O(1), otherwise the items are copied one by one.
+ *
+ * @src must not be iterated through while being spliced.
+ *
+ * Return: -1 if @dst or @src are NULL, if they are the same queue, or in case
+ * of memory allocation error when moving items. 0 if @src was successfully
+ * emptied into @dst.
+ */
+int queue_splice(queue_t dst, queue_t src);
+
 /*
  * queue_delete - Delete data item
  * @queue: Queue in which to delete item
@@ -0,0 +1,277 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "queue.h"
+#include "uthread_sched.h"
+
+/*
+ * Round-robin policy
+ */
+static queue_t rr_queue;
+
+static int rr_init(void)
+{
+	rr_queue = queue_create();
+	return rr_queue ? 0 : -1;
+}
+
+static void rr_fini(void)
+{
+	queue_destroy(rr_queue);
+	rr_queue = NULL;
+}
+
+static int rr_enqueue(uthread_t item, enum uthread_sched_event why)
+{
+	(void)why;
+	return queue_enqueue(rr_queue, item);
+}
+
+static uthread_t rr_pick_next(void)
+{
+	void *item;
+
+	if (queue_dequeue(rr_queue, &item) == -1)
+		return NULL;
+	return item;
+}
+
+/* Woken up threads are moved at once, by splicing their queue */
+static int rr_enqueue_queue(queue_t items)
+{
+	return queue_splice(rr_queue, items);
+}
+
+const struct uthread_sched_ops uthread_sched_rr = {
+	.name = "rr",
+	.init = rr_init,
+	.fini = rr_fini,
+	.enqueue = rr_enqueue,
+	.pick_next = rr_pick_next,
+	.enqueue_queue = rr_enqueue_queue,
+};
+
+/*
+ * Round-robin policy with a "run next" slot
+ *
+ * The most recently created or woken up item goes to a single-entry slot,
+ * from which it is picked before the FIFO, demoting the previous occupant to
+ * the FIFO. Threads handing work to each other thus run back to back while
+ * their data is still in cache. To keep such a chain from starving the rest
+ * of the FIFO, at most RUNNEXT_LIMIT items in a row are picked from the slot.
+ */
+#define RUNNEXT_LIMIT 32
+
+static uthread_t runnext;
+static unsigned int runnext_streak;
+
+static int runnext_init(void)
+{
+	runnext = NULL;
+	runnext_streak = 0;
+	return rr_init();
+}
+
+static int runnext_enqueue(uthread_t item, enum uthread_sched_event why)
+{
+	if (why == UTHREAD_SCHED_YIELD || why == UTHREAD_SCHED_PREEMPT)
+		return queue_enqueue(rr_queue, item);
+
+	if (runnext && queue_enqueue(rr_queue, runnext) == -1)
+		return -1;
+	runnext = item;
+	return 0;
+}
+
+static uthread_t runnext_pick_next(void)
+{
+	uthread_t item = runnext;
+
+	/* Past the limit, the slot waits for the head of the FIFO to run */
+	if (item && (runnext_streak < RUNNEXT_LIMIT ||
+		     queue_length(rr_queue) == 0)) {
+		runnext = NULL;
+		runnext_streak++;
+		return item;
+	}
+
+	runnext_streak = 0;
+	return rr_pick_next();
+}
+
+const struct uthread_sched_ops uthread_sched_runnext = {
+	.name = "runnext",
+	.init = runnext_init,
+	.fini = rr_fini,
+	.enqueue = runnext_enqueue,
+	.pick_next = runnext_pick_next,
+	.enqueue_queue = rr_enqueue_queue,
+};
+
+/*
+ * LIFO policy
+ *
+ * Items are kept in a double-ended ring buffer: new and woken up items are
+ * pushed at the front, and threads giving up the CPU at the back.
+ */
+static uthread_t *lifo_ring;
+static size_t lifo_capacity, lifo_first, lifo_size;
+
+static int lifo_init(void)
+{
+	lifo_capacity = 16;
+	lifo_first = lifo_size = 0;
+	lifo_ring = malloc(lifo_capacity * sizeof(*lifo_ring));
+	return lifo_ring ? 0 : -1;
+}
+
+static void lifo_fini(void)
+{
+	free(lifo_ring);
+	lifo_ring = NULL;
+}
+
+static int lifo_grow(void)
+{
+	uthread_t *ring = malloc(2 * lifo_capacity * sizeof(*ring));
+	size_t i;
+
+	if (!ring)
+		return -1;
+
+	for (i = 0; i < lifo_size; i++)
+		ring[i] = lifo_ring[(lifo_first + i) % lifo_capacity];
+	free(lifo_ring);
+	lifo_ring = ring;
+	lifo_first = 0;
+	lifo_capacity *= 2;
+	return 0;
+}
+
+static int lifo_enqueue(uthread_t item, enum uthread_sched_event why)
+{
+	if (lifo_size == lifo_capacity && lifo_grow() == -1)
+		return -1;
+
+	if (why == UTHREAD_SCHED_YIELD || why == UTHREAD_SCHED_PREEMPT) {
+		lifo_ring[(lifo_first + lifo_size) % lifo_capacity] = item;
+	} else {
+		lifo_first = (lifo_first + lifo_capacity - 1) % lifo_capacity;
+		lifo_ring[lifo_first] = item;
+	}
+	lifo_size++;
+	return 0;
+}
+
+static uthread_t lifo_pick_next(void)
+{
+	uthread_t item;
+
+	if (lifo_size == 0)
+		return NULL;
+
+	item = lifo_ring[lifo_first];
+	lifo_first = (lifo_first + 1) % lifo_capacity;
+	lifo_size--;
+	return item;
+}
+
+const struct uthread_sched_ops uthread_sched_lifo = {
+	.name = "lifo",
+	.init = lifo_init,
+	.fini = lifo_fini,
+	.enqueue = lifo_enqueue,
+	.pick_next = lifo_pick_next,
+};
+
+/*
+ * Priority policy
+ *
+ * One FIFO queue per priority level, and a bitmap of the non-empty ones.
+ */
+static queue_t prio_queues[UTHREAD_SCHED_PRIO_MAX + 1];
+static unsigned int prio_mask;
+
+static void prio_fini(void)
+{
+	int i;
+
+	for (i = 0; i <= UTHREAD_SCHED_PRIO_MAX; i++) {
+		queue_destroy(prio_queues[i]);
+		prio_queues[i] = NULL;
+	}
+}
+
+static int prio_init(void)
+{
+	int i;
+
+	prio_mask = 0;
+	for (i = 0; i <= UTHREAD_SCHED_PRIO_MAX; i++) {
+		prio_queues[i] = queue_create();
+		if (!prio_queues[i]) {
+			prio_fini();
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int prio_clamp(int prio)
+{
+	if (prio < 0)
+		return 0;
+	if (prio > UTHREAD_SCHED_PRIO_MAX)
+		return UTHREAD_SCHED_PRIO_MAX;
+	return prio;
+}
+
+static int prio_enqueue(uthread_t item, enum uthread_sched_event why)
+{
+	int prio = prio_clamp(uthread_get_priority(item));
+	(void)why;
+
+	if (queue_enqueue(prio_queues[prio], item) == -1)
+		return -1;
+	prio_mask |= 1U << prio;
+	return 0;
+}
+
+static uthread_t prio_pick_next(void)
+{
+	void *item;
+	int prio;
+
+	if (!prio_mask)
+		return NULL;
+
+	prio = 31 - __builtin_clz(prio_mask);
+	queue_dequeue(prio_queues[prio], &item);
+	if (queue_length(prio_queues[prio]) == 0)
+		prio_mask &= ~(1U << prio);
+	return item;
+}
+
+/* Move a thread whose priority changed, e.g. by inheritance, to its new level */
+static void prio_requeue(uthread_t uthread, int old_priority)
+{
+	int old = prio_clamp(old_priority);
+
+	if (old == prio_clamp(uthread_get_priority(uthread)) ||
+	    queue_delete(prio_queues[old], uthread) == -1)
+		return;
+
+	if (queue_length(prio_queues[old]) == 0)
+		prio_mask &= ~(1U << old);
+	prio_enqueue(uthread, UTHREAD_SCHED_WAKE);
+}
+
+const struct uthread_sched_ops uthread_sched_prio = {
+	.name = "prio",
+	.init = prio_init,
+	.fini = prio_fini,
+	.enqueue = prio_enqueue,
+	.pick_next = prio_pick_next,
+	.requeue = prio_requeue,
+};
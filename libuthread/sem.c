@@ -1,16 +1,265 @@
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #include "private.h"
-#include "queue.h"
 #include "sem.h"
 
+struct sem_waiter;
+
 struct semaphore {
     size_t count;   // Number of resources available
-    queue_t queue;  // Queue of threads waiting for this semaphore
+    struct sem_waiter *head;        // Oldest waiter, NULL if none
+    struct sem_waiter *tail;        // Newest waiter
+    atomic_size_t async_ups;        // Releases posted by sem_up_async()
+    struct uthread_inject inject;   // Node handing them to the scheduler
+    size_t nr_waiters;              // Registrations in the wait list
+    struct sem_stats stats;         // Contention counters, but the wait times
+    uint64_t wait_ticks;            // Total wait, in uthread_clock() ticks
+    uint64_t max_wait_ticks;        // Longest wait, in ticks
+    char *name;                     // Name given at creation, NULL if none
+    bool lock;                      // Whether created by sem_create_lock()
+    struct uthread_tcb *owner;      // Thread holding the lock, if any
+    struct sem_waiter *top;         // Waiter of highest priority of a lock
+    struct sem_waiter *bottom;      // Waiter of lowest priority
+    sem_t held_next;                // Next lock held by the same thread
+    sem_t prev;                     // Older semaphore in the list of all of them
+    sem_t next;                     // Newer semaphore
 };
 
-sem_t sem_create(size_t count)
+/* All the semaphores, for sem_report() */
+static sem_t sems_head, sems_tail;
+
+/*
+ * Thread waiting for resources, which lives on its stack while it is blocked.
+ * The oldest waiter always wants more resources than are available, so that
+ * waiters are served in FIFO order and none of them is starved by later ones
+ * asking for less.
+ *
+ * Waiters are linked in both directions, so that uthread_select() can cancel
+ * the registrations which lost the race in constant time. The waiters of a lock
+ * are also kept sorted by priority, for priority inheritance.
+ */
+struct sem_waiter {
+    struct sem_waiter *prev;        // Older waiter of the same semaphore
+    struct sem_waiter *next;        // Newer waiter of the same semaphore
+    struct uthread_tcb *uthread;    // Blocked thread
+    size_t n;                       // Number of resources it waits for
+    struct sem_select *select;      // Select it belongs to, NULL for sem_down_n()
+    sem_t sem;                      // Semaphore waited on
+    int prio;                       // Priority of the thread, for a lock
+    struct sem_waiter *higher;      // Waiter of higher or equal priority
+    struct sem_waiter *lower;       // Waiter of lower priority
+};
+
+/*
+ * Thread waiting in uthread_select(), with one waiter per semaphore
+ */
+struct sem_select {
+    sem_t *sems;                    // Semaphores waited on
+    struct sem_waiter *waiters;     // Registration on each of them
+    size_t n;                       // Number of semaphores
+    size_t fired;                   // Index of the winner, @n for the deadline
+    struct uthread_timer timer;     // Deadline, if any
+    bool has_timer;                 // Whether @timer is armed
+};
+
+/*
+ * Insert @waiter among the waiters of lock @sem sorted by priority, after those
+ * of the same priority. Waiters of equal priority thus cost constant time.
+ */
+static void sem_prio_insert(sem_t sem, struct sem_waiter *waiter)
+{
+    struct sem_waiter *higher = sem->bottom;
+
+    while (higher && higher->prio < waiter->prio) {
+        higher = higher->higher;
+    }
+
+    waiter->higher = higher;
+    if (higher) {
+        waiter->lower = higher->lower;
+        higher->lower = waiter;
+    } else {
+        waiter->lower = sem->top;
+        sem->top = waiter;
+    }
+    if (waiter->lower) {
+        waiter->lower->higher = waiter;
+    } else {
+        sem->bottom = waiter;
+    }
+}
+
+static void sem_prio_remove(sem_t sem, struct sem_waiter *waiter)
+{
+    if (waiter->higher) {
+        waiter->higher->lower = waiter->lower;
+    } else {
+        sem->top = waiter->lower;
+    }
+    if (waiter->lower) {
+        waiter->lower->higher = waiter->higher;
+    } else {
+        sem->bottom = waiter->higher;
+    }
+}
+
+static void sem_enqueue(sem_t sem, struct sem_waiter *waiter)
+{
+    if (++sem->nr_waiters > sem->stats.max_waiters) {
+        sem->stats.max_waiters = sem->nr_waiters;
+    }
+
+    waiter->sem = sem;
+    waiter->prev = sem->tail;
+    waiter->next = NULL;
+    if (sem->tail) {
+        sem->tail->next = waiter;
+    } else {
+        sem->head = waiter;
+    }
+    sem->tail = waiter;
+
+    if (sem->lock) {
+        waiter->prio = uthread_get_priority(waiter->uthread);
+        sem_prio_insert(sem, waiter);
+    }
+}
+
+static void sem_unlink(sem_t sem, struct sem_waiter *waiter)
+{
+    sem->nr_waiters--;
+    if (waiter->prev) {
+        waiter->prev->next = waiter->next;
+    } else {
+        sem->head = waiter->next;
+    }
+    if (waiter->next) {
+        waiter->next->prev = waiter->prev;
+    } else {
+        sem->tail = waiter->prev;
+    }
+
+    if (sem->lock) {
+        sem_prio_remove(sem, waiter);
+    }
+}
+
+static void sem_drain_async(struct uthread_inject *node);
+
+/* Longest chain of locks followed when passing an inherited priority on */
+#define LOCK_CHAIN_MAX 64
+
+/*
+ * Priority inheritance
+ *
+ * The owner of a lock runs with the highest priority of the threads waiting on
+ * the locks it holds. If it is itself blocked on locks, its priority in turn
+ * passes on to the owners of these locks, and so on.
+ */
+
+static void sem_propagate_waits(struct uthread_tcb *uthread, int depth);
+
+/*
+ * Recompute the priority @owner inherits from the waiters of its locks, and
+ * pass any change on along the chains of locks it is blocked on. The length of
+ * the chains is bounded, should the locks be deadlocked in a cycle.
+ */
+static void sem_propagate_depth(struct uthread_tcb *owner, int depth)
+{
+    int before, inherited = INT_MIN;
+    sem_t held;
+
+    if (!owner || depth >= LOCK_CHAIN_MAX) {
+        return;
+    }
+
+    before = uthread_get_priority(owner);
+    for (held = uthread_locks(owner)->held; held; held = held->held_next) {
+        if (held->top && held->top->prio > inherited) {
+            inherited = held->top->prio;
+        }
+    }
+
+    uthread_inherit_priority(owner, inherited);
+    if (uthread_get_priority(owner) != before) {
+        sem_propagate_waits(owner, depth + 1);
+    }
+}
+
+static void sem_propagate(struct uthread_tcb *owner)
+{
+    sem_propagate_depth(owner, 0);
+}
+
+/*
+ * Move @uthread, whose priority changed, among the waiters of the locks it is
+ * blocked on, and pass its priority on to their owners
+ */
+static void sem_propagate_waits(struct uthread_tcb *uthread, int depth)
+{
+    struct uthread_locks *locks = uthread_locks(uthread);
+    int prio = uthread_get_priority(uthread);
+    size_t i;
+
+    for (i = 0; i < locks->nr_waiting; i++) {
+        struct sem_waiter *waiter = &locks->waiting[i];
+        sem_t sem = waiter->sem;
+
+        if (!sem->lock || waiter->prio == prio) {
+            continue;
+        }
+        sem_prio_remove(sem, waiter);
+        waiter->prio = prio;
+        sem_prio_insert(sem, waiter);
+        sem_propagate_depth(sem->owner, depth);
+    }
+}
+
+void uthread_lock_priority_changed(struct uthread_tcb *uthread)
+{
+    sem_propagate_waits(uthread, 0);
+}
+
+/* Record that @uthread is blocked on the @n registrations of @waiters */
+static void sem_wait_locks(struct uthread_tcb *uthread,
+                           struct sem_waiter *waiters, size_t n)
+{
+    struct uthread_locks *locks = uthread_locks(uthread);
+
+    locks->waiting = waiters;
+    locks->nr_waiting = n;
+}
+
+/* Make @uthread the owner of lock @sem */
+static void sem_own(sem_t sem, struct uthread_tcb *uthread)
+{
+    struct uthread_locks *locks = uthread_locks(uthread);
+
+    sem->owner = uthread;
+    sem->held_next = locks->held;
+    locks->held = sem;
+}
+
+/* Take lock @sem away from its owner */
+static void sem_disown(sem_t sem)
+{
+    sem_t *pp = &uthread_locks(sem->owner)->held;
+
+    while (*pp != sem) {
+        pp = &(*pp)->held_next;
+    }
+    *pp = sem->held_next;
+    sem->owner = NULL;
+}
+
+sem_t sem_create_named(size_t count, const char *name)
 {
     // Allocate memory for the semaphore
     sem_t sem = malloc(sizeof(struct semaphore));
@@ -18,72 +267,428 @@ sem_t sem_create(size_t count)
         return NULL;    // If allocation fails, return NULL
     }
 
+    sem->name = NULL;
+    if (name && !(sem->name = strdup(name))) {
+        free(sem);
+        return NULL;
+    }
+
     // Initialize the semaphore's count and queue
     sem->count = count;
-    sem->queue = queue_create();
-    if (!sem->queue) {
-        free(sem);
-        return NULL;    // If queue creation fails, free the semaphore and return NULL
+    sem->head = NULL;
+    sem->tail = NULL;
+    atomic_init(&sem->async_ups, 0);
+    sem->inject.func = sem_drain_async;
+    sem->nr_waiters = 0;
+    sem->lock = false;
+    sem->owner = NULL;
+    sem->top = NULL;
+    sem->bottom = NULL;
+    memset(&sem->stats, 0, sizeof(sem->stats));
+    sem->wait_ticks = 0;
+    sem->max_wait_ticks = 0;
+
+    // Register it for sem_report()
+    preempt_disable();
+    sem->prev = sems_tail;
+    sem->next = NULL;
+    if (sems_tail) {
+        sems_tail->next = sem;
+    } else {
+        sems_head = sem;
     }
+    sems_tail = sem;
+    preempt_enable();
 
     // If all initializations are successful, return the semaphore
     return sem;
 }
 
+sem_t sem_create(size_t count)
+{
+    return sem_create_named(count, NULL);
+}
+
+sem_t sem_create_lock(const char *name)
+{
+    sem_t sem = sem_create_named(1, name);
+
+    if (sem) {
+        sem->lock = true;
+    }
+    return sem;
+}
+
 int sem_destroy(sem_t sem)
 {
-    // If the semaphore is NULL or there are still threads waiting on it, return -1
-    if (!sem || queue_length(sem->queue) > 0) {
+    // If the semaphore is NULL or there are still threads waiting on it, or
+    // asynchronous releases yet to be processed, return -1
+    // A held lock cannot be destroyed either
+    if (!sem || sem->head || atomic_load(&sem->async_ups) > 0 || sem->owner) {
         return -1;
     }
 
-    // Otherwise, destroy the queue and free the semaphore
-    queue_destroy(sem->queue);
+    preempt_disable();
+    if (sem->prev) {
+        sem->prev->next = sem->next;
+    } else {
+        sems_head = sem->next;
+    }
+    if (sem->next) {
+        sem->next->prev = sem->prev;
+    } else {
+        sems_tail = sem->prev;
+    }
+    preempt_enable();
+
+    // Otherwise, free the semaphore
+    free(sem->name);
     free(sem);
 
     return 0;
 }
 
-int sem_down(sem_t sem)
+int sem_down_n(sem_t sem, size_t n)
 {
     // If the semaphore is NULL, return -1
-    if (!sem) {
+    if (!sem || n == 0) {
         return -1;
     }
 
-    // If the count is 0 (no resources available), block the current thread and add it to the semaphore's queue
-    while (sem->count == 0) {
-        queue_enqueue(sem->queue, uthread_current());
-        uthread_block();
+    // A lock is taken one at a time, and not again by its owner
+    if (sem->lock && (n != 1 || sem->owner == uthread_current())) {
+        return -1;
+    }
 
-        // Recheck the semaphore count after unblocking for the corner case.
-        if (sem->count == 0) {
-            continue;
+    UTHREAD_TRACE_EVENT(TRACE_SEM_DOWN, uthread_current(), sem);
+
+    preempt_disable();
+
+    // If not enough resources are available, or if older threads are waiting,
+    // block the current thread and add it to the semaphore's queue
+    if (sem->count < n || sem->head) {
+        struct sem_waiter waiter = { .uthread = uthread_current(), .n = n };
+
+        sem_enqueue(sem, &waiter);
+        if (sem->lock) {
+            // Lend our priority to the owner until the lock is handed over
+            sem_wait_locks(waiter.uthread, &waiter, 1);
+            sem_propagate(sem->owner);
         }
+        uthread_block();
+
+        // The resources were handed over by sem_up(), which may also have been
+        // followed by sem_destroy(), so @sem must not be accessed anymore.
+        return 0;
     }
 
     // Decrease the semaphore's count and return
-    sem->count--;
+    sem->count -= n;
+    sem->stats.acquisitions++;
+    if (sem->lock) {
+        sem_own(sem, uthread_current());
+    }
+    preempt_enable();
     return 0;
 }
 
-int sem_up(sem_t sem)
+int sem_down(sem_t sem)
+{
+    return sem_down_n(sem, 1);
+}
+
+/*
+ * Wake up the thread of @select, cancelling all its registrations but the one
+ * of semaphore @fired (already dequeued), and its deadline
+ */
+static void sem_select_wake(struct sem_select *select, size_t fired)
+{
+    size_t i;
+
+    select->fired = fired;
+    sem_wait_locks(select->waiters[0].uthread, NULL, 0);
+    for (i = 0; i < select->n; i++) {
+        if (i != fired) {
+            sem_unlink(select->sems[i], &select->waiters[i]);
+
+            // The owner of a lock may have inherited the priority of the thread
+            if (select->sems[i]->lock) {
+                sem_propagate(select->sems[i]->owner);
+            }
+        }
+    }
+    if (select->has_timer && fired != select->n) {
+        uthread_timer_cancel(&select->timer);
+    }
+    uthread_unblock(select->waiters[0].uthread);
+}
+
+static void sem_select_timeout(struct uthread_timer *timer)
+{
+    struct sem_select *select = (struct sem_select *)
+        ((char *)timer - offsetof(struct sem_select, timer));
+
+    sem_select_wake(select, select->n);
+}
+
+/*
+ * Release @n resources, with preemption already disabled
+ */
+static void sem_release(sem_t sem, size_t n)
+{
+    struct sem_waiter *waiter;
+    uint64_t now = 0;
+
+    sem->count += n;
+
+    // Hand the resources directly over to the oldest waiters, in a single pass,
+    // so that no other thread can snatch them before they run. Stop at the
+    // first waiter which wants more than what is left.
+    while ((waiter = sem->head) && waiter->n <= sem->count) {
+        sem_unlink(sem, waiter);
+        sem->count -= waiter->n;
+
+        if (!now) {
+            now = uthread_clock();
+        }
+        // The waiter has been waiting since it blocked, and the clock is read
+        // once per release. Waits are converted to nanoseconds when reported.
+        uint64_t wait = now - uthread_blocked_since(waiter->uthread);
+        sem->stats.acquisitions++;
+        sem->stats.contended++;
+        sem->wait_ticks += wait;
+        if (wait > sem->max_wait_ticks) {
+            sem->max_wait_ticks = wait;
+        }
+
+        // A lock goes to the waiter, along with the priority of the others
+        if (sem->lock) {
+            sem_wait_locks(waiter->uthread, NULL, 0);
+            sem_own(sem, waiter->uthread);
+            sem_propagate(waiter->uthread);
+        }
+
+        if (waiter->select) {
+            sem_select_wake(waiter->select, waiter - waiter->select->waiters);
+        } else {
+            uthread_unblock(waiter->uthread);
+        }
+    }
+}
+
+int sem_up_n(sem_t sem, size_t n)
 {
     // If the semaphore is NULL, return -1
-    if (!sem) {
+    if (!sem || n == 0) {
+        return -1;
+    }
+
+    // Only the owner of a lock can release it
+    if (sem->lock && (n != 1 || sem->owner != uthread_current())) {
+        return -1;
+    }
+
+    UTHREAD_TRACE_EVENT(TRACE_SEM_UP, uthread_current(), sem);
+
+    preempt_disable();
+    if (sem->lock) {
+        struct uthread_tcb *owner = sem->owner;
+
+        // Give back what was inherited through this lock
+        sem_disown(sem);
+        sem_propagate(owner);
+    }
+    sem_release(sem, n);
+    preempt_enable();
+    return 0;
+}
+
+int sem_up(sem_t sem)
+{
+    return sem_up_n(sem, 1);
+}
+
+/*
+ * Called by the scheduler to apply the releases posted by sem_up_async()
+ */
+static void sem_drain_async(struct uthread_inject *node)
+{
+    sem_t sem = (sem_t)((char *)node - offsetof(struct semaphore, inject));
+
+    // Posters that come after the exchange inject the semaphore again
+    size_t n = atomic_exchange(&sem->async_ups, 0);
+
+    UTHREAD_TRACE_EVENT(TRACE_SEM_UP, uthread_current(), sem);
+    sem_release(sem, n);
+}
+
+int sem_up_async(sem_t sem)
+{
+    // If the semaphore is NULL, or a lock which has an owner to release it,
+    // return -1
+    if (!sem || sem->lock) {
+        return -1;
+    }
+
+    // Only the first pending release needs to inject the semaphore
+    if (atomic_fetch_add(&sem->async_ups, 1) == 0) {
+        uthread_inject(&sem->inject);
+    }
+    return 0;
+}
+
+
+/* Number of registrations of uthread_select() kept on the stack */
+#define SELECT_STACK_WAITERS 8
+
+int uthread_select(sem_t *sems, size_t n, const struct timespec *deadline)
+{
+    struct sem_waiter stack_waiters[SELECT_STACK_WAITERS];
+    struct sem_select select = { .sems = sems, .n = n };
+    size_t i;
+
+    if (!sems || n == 0 || n > INT_MAX) {
         return -1;
     }
+    // A lock cannot be taken again by its owner, which would wait on itself
+    for (i = 0; i < n; i++) {
+        if (!sems[i] || (sems[i]->lock && sems[i]->owner == uthread_current())) {
+            return -1;
+        }
+    }
 
-    // Increase the semaphore's count
-    sem->count++;
+    preempt_disable();
 
-    // If there are threads waiting on the semaphore, dequeue one and unblock it
-    if (queue_length(sem->queue) > 0) {
-        struct uthread_tcb *unblocked_thread;
-        queue_dequeue(sem->queue, (void **)&unblocked_thread);
-        uthread_unblock(unblocked_thread);
+    // Take the first available semaphore without blocking, as sem_down() would
+    for (i = 0; i < n; i++) {
+        if (sems[i]->count > 0 && !sems[i]->head) {
+            sems[i]->count--;
+            sems[i]->stats.acquisitions++;
+            if (sems[i]->lock) {
+                sem_own(sems[i], uthread_current());
+            }
+            preempt_enable();
+            return i;
+        }
     }
 
+    if (deadline) {
+        select.timer.deadline = (uint64_t)deadline->tv_sec * 1000000000ULL +
+                                deadline->tv_nsec;
+        select.timer.func = sem_select_timeout;
+        if (select.timer.deadline <= uthread_monotonic_ns()) {
+            preempt_enable();
+            return n;
+        }
+    }
+
+    select.waiters = stack_waiters;
+    if (n > SELECT_STACK_WAITERS) {
+        select.waiters = malloc(n * sizeof(struct sem_waiter));
+        if (!select.waiters) {
+            preempt_enable();
+            return -1;
+        }
+    }
+    if (deadline) {
+        if (uthread_timer_add(&select.timer) == -1) {
+            if (select.waiters != stack_waiters) {
+                free(select.waiters);
+            }
+            preempt_enable();
+            return -1;
+        }
+        select.has_timer = true;
+    }
+
+    // Wait in line on every semaphore, until the first one hands a resource
+    // over or the deadline passes, which cancels all the other registrations
+    for (i = 0; i < n; i++) {
+        select.waiters[i].uthread = uthread_current();
+        select.waiters[i].n = 1;
+        select.waiters[i].select = &select;
+        sem_enqueue(sems[i], &select.waiters[i]);
+    }
+
+    // Lend our priority to the owners of the locks among them
+    sem_wait_locks(uthread_current(), select.waiters, n);
+    for (i = 0; i < n; i++) {
+        if (sems[i]->lock) {
+            sem_propagate(sems[i]->owner);
+        }
+    }
+    uthread_block();
+
+    if (select.waiters != stack_waiters) {
+        free(select.waiters);
+    }
+    return select.fired;
+}
+
+int sem_stats_get(sem_t sem, struct sem_stats *stats)
+{
+    if (!sem || !stats) {
+        return -1;
+    }
+
+    preempt_disable();
+    *stats = sem->stats;
+    stats->wait_ns = uthread_clock_ns(sem->wait_ticks);
+    stats->max_wait_ns = uthread_clock_ns(sem->max_wait_ticks);
+    preempt_enable();
     return 0;
 }
 
+static int sem_cmp_wait(const void *a, const void *b)
+{
+    const struct semaphore *x = *(const sem_t *)a;
+    const struct semaphore *y = *(const sem_t *)b;
+
+    return (y->wait_ticks > x->wait_ticks) - (y->wait_ticks < x->wait_ticks);
+}
+
+int sem_report(FILE *f)
+{
+    size_t n = 0, i;
+    sem_t sem, *sorted;
+
+    if (!f) {
+        return -1;
+    }
+
+    preempt_disable();
+    for (sem = sems_head; sem; sem = sem->next) {
+        n++;
+    }
+    sorted = malloc((n ? n : 1) * sizeof(*sorted));
+    if (!sorted) {
+        preempt_enable();
+        return -1;
+    }
+    for (i = 0, sem = sems_head; sem; sem = sem->next) {
+        sorted[i++] = sem;
+    }
+    qsort(sorted, n, sizeof(*sorted), sem_cmp_wait);
+
+    fprintf(f, "%-20s %10s %10s %12s %12s %8s\n", "semaphore", "acquired",
+            "contended", "wait_us", "max_wait_us", "waiters");
+    for (i = 0; i < n; i++) {
+        struct sem_stats *st = &sorted[i]->stats;
+        double wait_us = uthread_clock_ns(sorted[i]->wait_ticks) / 1000.0;
+        double max_wait_us = uthread_clock_ns(sorted[i]->max_wait_ticks) / 1000.0;
+
+        if (sorted[i]->name) {
+            fprintf(f, "%-20s", sorted[i]->name);
+        } else {
+            fprintf(f, "%-20p", (void *)sorted[i]);
+        }
+        fprintf(f, " %10llu %10llu %12.3f %12.3f %8zu\n",
+                (unsigned long long)st->acquisitions,
+                (unsigned long long)st->contended, wait_us, max_wait_us,
+                st->max_waiters);
+    }
+    preempt_enable();
+
+    free(sorted);
+    return 0;
+}
@@ -2,7 +2,9 @@
 #define _SEMAPHORE_H
 
 #include <stdint.h>
+#include <stdio.h>
 #include <sys/types.h>
+#include <time.h>
 
 /*
  * sem_t - Semaphore type
@@ -26,14 +28,49 @@ typedef struct semaphore *sem_t;
  */
 sem_t sem_create(size_t count);
 
+/*
+ * sem_create_named - Create a named semaphore
+ * @count: Semaphore count
+ * @name: Name shown by sem_report(), copied, or NULL
+ *
+ * Same as sem_create(), with a name to tell the semaphore apart from the
+ * others when profiling contention.
+ *
+ * Return: Pointer to initialized semaphore. NULL in case of failure when
+ * allocating the new semaphore or its name.
+ */
+sem_t sem_create_named(size_t count, const char *name);
+
+/*
+ * sem_create_lock - Create a semaphore used as a lock
+ * @name: Name shown by sem_report(), copied, or NULL
+ *
+ * Create a semaphore of count 1 which tracks its owner: the thread which took
+ * it last, and which alone can release it. sem_down_n() and sem_up_n() only
+ * accept a single resource, sem_up_async() is refused, and the owner cannot
+ * take the lock again.
+ *
+ * While threads wait on the lock, its owner runs with the highest of their
+ * priorities if higher than its own, so that threads of medium priority cannot
+ * hold up a thread of high priority by keeping the owner from running. If the
+ * owner is itself blocked on a lock, the priority passes on to the owner of
+ * that one, and so on. The owner gets its own priority back once it releases
+ * the lock. A thread must release its locks before exiting.
+ *
+ * Return: Pointer to initialized lock. NULL in case of failure when allocating
+ * the new semaphore or its name.
+ */
+sem_t sem_create_lock(const char *name);
+
 /*
  * sem_destroy - Deallocate a semaphore
  * @sem: Semaphore to deallocate
  *
  * Deallocate semaphore @sem.
  *
- * Return: -1 if @sem is NULL or if other threads are still being blocked on
- * @sem. 0 is @sem was successfully destroyed.
+ * Return: -1 if @sem is NULL, if other threads are still being blocked on
+ * @sem, if releases posted with sem_up_async() are yet to be applied, or if
+ * @sem is a lock held by a thread. 0 is @sem was successfully destroyed.
  */
 int sem_destroy(sem_t sem);
 
@@ -46,10 +83,26 @@ int sem_destroy(sem_t sem);
  * Taking an unavailable semaphore will cause the caller thread to be blocked
  * until the semaphore becomes available.
  *
- * Return: -1 if @sem is NULL. 0 if semaphore was successfully taken.
+ * Return: -1 if @sem is NULL, or a lock already held by the caller. 0 if
+ * semaphore was successfully taken.
  */
 int sem_down(sem_t sem);
 
+/*
+ * sem_down_n - Take several resources of a semaphore at once
+ * @sem: Semaphore to take
+ * @n: Number of resources to take
+ *
+ * Take @n resources from semaphore @sem, all at once: the caller thread never
+ * holds part of them while waiting for the rest. Waiting threads are served in
+ * FIFO order, so a thread waiting for many resources is not starved by later
+ * threads asking for fewer: they wait behind it.
+ *
+ * Return: -1 if @sem is NULL or if @n is 0. 0 if the resources were
+ * successfully taken.
+ */
+int sem_down_n(sem_t sem, size_t n);
+
 /*
  * sem_up - Release a semaphore
  * @sem: Semaphore to release
@@ -58,10 +111,101 @@ int sem_down(sem_t sem);
  *
  * If the waiting list associated to @sem is not empty, releasing a resource
  * also causes the first thread (i.e. the oldest) in the waiting list to be
- * unblocked.
+ * unblocked, if it only waits for this one resource (see sem_down_n()).
  *
- * Return: -1 if @sem is NULL. 0 if semaphore was successfully released.
+ * Return: -1 if @sem is NULL, or a lock not held by the caller. 0 if
+ * semaphore was successfully released.
  */
 int sem_up(sem_t sem);
 
+/*
+ * sem_up_n - Release several resources of a semaphore at once
+ * @sem: Semaphore to release
+ * @n: Number of resources to release
+ *
+ * Same as calling sem_up() @n times, in one pass: the released resources are
+ * handed over to the oldest waiting threads, as long as they cover what the
+ * oldest remaining one waits for.
+ *
+ * Return: -1 if @sem is NULL or if @n is 0. 0 if the resources were
+ * successfully released.
+ */
+int sem_up_n(sem_t sem, size_t n);
+
+/*
+ * sem_up_async - Release a semaphore from outside of the uthread runtime
+ * @sem: Semaphore to release
+ *
+ * Same as sem_up(), but may be called from any kernel thread (e.g., a pthread
+ * performing I/O on behalf of uthreads) or from a signal handler, even before
+ * the runtime is started. It is lock-free and async-signal-safe.
+ *
+ * The release is posted to the scheduler through a lock-free queue and takes
+ * effect at the next scheduling point. If the runtime is idle, waiting for such
+ * a release, it is woken up. Several releases posted before the scheduler gets
+ * to them are applied in a single batch.
+ *
+ * Return: -1 if @sem is NULL or a lock. 0 if the release was successfully
+ * posted.
+ */
+int sem_up_async(sem_t sem);
+
+/*
+ * uthread_select - Take the first available of several semaphores
+ * @sems: Array of semaphores to wait on
+ * @n: Number of semaphores in @sems
+ * @deadline: Absolute CLOCK_MONOTONIC time after which to give up, or NULL to
+ * wait without time limit
+ *
+ * Take a resource from the first semaphore of @sems which is available. If none
+ * is, block the caller thread until one of them is released, waiting in line
+ * on all of them at once as sem_down() would on each, or until @deadline.
+ * Whichever comes first cancels the other registrations.
+ *
+ * Return: Index in @sems of the semaphore a resource was taken from, @n if
+ * @deadline passed first, -1 if @sems or one of its semaphores is NULL, if @n
+ * is 0, if one of the semaphores is a lock held by the caller, or in case of
+ * failure (memory allocation).
+ */
+int uthread_select(sem_t *sems, size_t n, const struct timespec *deadline);
+
+/*
+ * sem_stats - Contention counters of a semaphore
+ *
+ * Every semaphore keeps these counters. The uncontended path of sem_down() only
+ * counts the acquisition: the clock is only read for threads which wait.
+ */
+struct sem_stats {
+	uint64_t acquisitions;	/* Successful sem_down_n() and uthread_select() */
+	uint64_t contended;	/* Acquisitions which had to wait */
+	uint64_t wait_ns;	/* Total time waited by contended acquisitions */
+	uint64_t max_wait_ns;	/* Longest wait */
+	size_t max_waiters;	/* Peak number of waiting threads */
+};
+
+/*
+ * sem_stats_get - Get the contention counters of a semaphore
+ * @sem: Semaphore
+ * @stats: Where to copy the counters
+ *
+ * Waits count from the time a thread starts waiting to the time the resources
+ * are handed over to it. Waits which end with the deadline of uthread_select()
+ * are not counted.
+ *
+ * Return: -1 if @sem or @stats is NULL, 0 otherwise.
+ */
+int sem_stats_get(sem_t sem, struct sem_stats *stats);
+
+/*
+ * sem_report - Print the contention counters of all semaphores
+ * @f: Stream to write to
+ *
+ * Print one line per existing semaphore, identified by its name or else by its
+ * address, those with the longest total wait time first.
+ *
+ * Return: -1 if @f is NULL or in case of memory allocation failure, 0
+ * otherwise.
+ */
+int sem_report(FILE *f);
+
 #endif /* _SEMAPHORE_H */
@@ -0,0 +1,163 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "private.h"
+#include "stack.h"
+
+/* Byte pattern painted on profiled stacks */
+#define STACK_CANARY 0xa5
+
+/* Smallest stack size class */
+#define STACK_MIN_CLASS 8192
+
+/* Room left for a signal frame on top of the measured usage */
+#define STACK_SIGNAL_ROOM 4096
+
+/* Number of threads to measure before picking a size class */
+#define STACK_MIN_SAMPLES 4
+
+/* Histogram buckets, the first one counting high-water marks up to 512 bytes */
+#define STACK_BUCKET_SHIFT 9
+#define STACK_NR_BUCKETS 7
+
+/* Number of entry functions that can be profiled, must be a power of two */
+#define STACK_NR_ENTRIES 256
+
+/* Profiling data of an entry function */
+struct stack_entry {
+	uthread_func_t func;		/* Entry function, NULL if unused */
+	unsigned long samples;		/* Number of threads measured */
+	size_t max_used;		/* Largest high-water mark */
+	size_t size_class;		/* Stack size picked for later threads */
+	unsigned long hist[STACK_NR_BUCKETS];
+};
+
+static struct stack_entry entries[STACK_NR_ENTRIES];
+static bool profiling;
+static bool autosize;
+
+void uthread_stack_profile(bool enable)
+{
+	profiling = enable;
+}
+
+void uthread_stack_autosize(bool enable)
+{
+	autosize = enable;
+}
+
+bool uthread_stack_profiling(void)
+{
+	return profiling;
+}
+
+/*
+ * Find the entry of @func in the open-addressing hash table, creating it if
+ * @create is true. Return NULL if not found or if the table is full.
+ */
+static struct stack_entry *stack_lookup(uthread_func_t func, bool create)
+{
+	size_t h = ((uintptr_t)func >> 4) & (STACK_NR_ENTRIES - 1);
+	size_t i;
+
+	for (i = 0; i < STACK_NR_ENTRIES; i++) {
+		struct stack_entry *e = &entries[(h + i) & (STACK_NR_ENTRIES - 1)];
+
+		if (e->func == func)
+			return e;
+		if (!e->func) {
+			if (!create)
+				return NULL;
+			e->func = func;
+			e->size_class = UTHREAD_STACK_SIZE;
+			return e;
+		}
+	}
+
+	return NULL;
+}
+
+size_t uthread_stack_size(uthread_func_t func)
+{
+	size_t def = uthread_arena_stack_size();
+	struct stack_entry *e;
+
+	if (!def)
+		def = UTHREAD_STACK_SIZE;
+	if (!autosize)
+		return def;
+
+	e = stack_lookup(func, false);
+	if (!e || e->samples < STACK_MIN_SAMPLES)
+		return def;
+
+	return e->size_class;
+}
+
+void uthread_stack_paint(void *stack, size_t size)
+{
+	memset(stack, STACK_CANARY, size);
+}
+
+void uthread_stack_record(uthread_func_t func, void *stack, size_t size)
+{
+	const unsigned char *bottom = stack;
+	struct stack_entry *e;
+	size_t untouched = 0, used, bucket = 0, needed;
+
+	/* Stacks grow down, so the untouched bytes are at the bottom */
+	while (untouched < size && bottom[untouched] == STACK_CANARY)
+		untouched++;
+	used = size - untouched;
+
+	e = stack_lookup(func, true);
+	if (!e)
+		return;
+
+	while (bucket < STACK_NR_BUCKETS - 1 &&
+	       used > (size_t)1 << (bucket + STACK_BUCKET_SHIFT))
+		bucket++;
+	e->hist[bucket]++;
+	e->samples++;
+
+	if (used > e->max_used) {
+		e->max_used = used;
+
+		/* Smallest class fitting twice the usage plus a signal frame */
+		needed = 2 * used + STACK_SIGNAL_ROOM;
+		e->size_class = STACK_MIN_CLASS;
+		while (e->size_class < needed &&
+		       e->size_class < UTHREAD_STACK_SIZE)
+			e->size_class <<= 1;
+	}
+}
+
+int uthread_stack_profile_dump(FILE *f)
+{
+	size_t i, b;
+
+	if (!f)
+		return -1;
+
+	fprintf(f, "%-18s %8s %8s %8s  histogram (<=512, <=1K, ..., more)\n",
+		"function", "threads", "max", "size");
+	for (i = 0; i < STACK_NR_ENTRIES; i++) {
+		struct stack_entry *e = &entries[i];
+
+		if (!e->func)
+			continue;
+
+		fprintf(f, "%-18p %8lu %8zu %8zu ", (void *)(uintptr_t)e->func,
+			e->samples, e->max_used,
+			e->samples < STACK_MIN_SAMPLES ?
+			(size_t)UTHREAD_STACK_SIZE : e->size_class);
+		for (b = 0; b < STACK_NR_BUCKETS; b++)
+			fprintf(f, " %lu", e->hist[b]);
+		fprintf(f, "\n");
+	}
+
+	return 0;
+}
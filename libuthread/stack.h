@@ -0,0 +1,89 @@
+#ifndef _STACK_H
+#define _STACK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+ * Stack profiling
+ *
+ * Every thread runs on a stack of UTHREAD_STACK_SIZE bytes (32 KiB) by default.
+ * To find out how much of it threads really use, stacks can be painted with a
+ * known pattern when allocated. When a thread exits, the deepest byte that was
+ * overwritten gives the thread's stack high-water mark, which is recorded in a
+ * histogram kept per thread entry function.
+ *
+ * From these measurements, the library can pick a smaller stack size class for
+ * the threads later created with the same entry function. Since a thread that
+ * uses more stack than ever measured would silently overflow, this is opt-in.
+ */
+
+/*
+ * uthread_stack_profile - Enable or disable stack profiling
+ * @enable: Whether stacks allocated from now on should be profiled
+ *
+ * Painting a stack costs a memset() of its whole size at thread creation, and
+ * measuring it a scan at thread exit.
+ */
+void uthread_stack_profile(bool enable);
+
+/*
+ * uthread_stack_autosize - Enable or disable automatic stack sizing
+ * @enable: Whether threads should get stacks sized from profiling data
+ *
+ * Once enough threads of an entry function have been profiled, threads created
+ * with that function get the smallest size class that fits twice their largest
+ * high-water mark, plus room for a signal frame. Profiling should be left
+ * enabled, so that a thread coming close to the end of its stack moves its
+ * entry function up to a larger class.
+ */
+void uthread_stack_autosize(bool enable);
+
+/*
+ * uthread_stack_profile_dump - Print stack profiling data
+ * @f: Stream to write to
+ *
+ * For each profiled entry function, print its address, the number of threads
+ * measured, their largest high-water mark, the stack size that automatic
+ * sizing picks for it, and the histogram of the high-water marks.
+ *
+ * Return: -1 if @f is NULL, 0 otherwise
+ */
+int uthread_stack_profile_dump(FILE *f);
+
+/*
+ * Stack arena
+ *
+ * With many threads, stacks allocated one by one end up scattered across the
+ * address space, and switching between threads misses in the TLB. An arena
+ * reserves one large region instead, backed by huge pages where available, and
+ * cuts it into fixed-size slots handed out through a bitmap. Huge pages are
+ * only worth it if threads touch a good part of their slot, so the slot size
+ * should be picked close to what threads need.
+ *
+ * In guard page mode, the lowest page of each slot is made inaccessible the
+ * first time the slot is handed out, so that a stack overflow faults instead of
+ * corrupting the neighbouring stack. This uses one memory mapping per slot, and
+ * the number of mappings of a process is limited (see vm.max_map_count), so
+ * slots beyond that limit go without guard page.
+ */
+
+/*
+ * uthread_stack_arena - Set up the stack arena
+ * @nstacks: Number of slots, 0 to release the current arena
+ * @size: Size of a slot including its guard page (in bytes), 0 for
+ *	UTHREAD_STACK_SIZE plus the guard page
+ * @guard: Whether slots should get a guard page
+ *
+ * Threads created once the arena is set up get their stack from it, and the
+ * usable size of a slot replaces UTHREAD_STACK_SIZE as the default stack size.
+ * Threads whose stack does not fit in a slot, or created while all the slots
+ * are in use, get their stack from malloc() as usual.
+ *
+ * Return: -1 if stacks from the current arena are still in use, if @size is too
+ * small for a guard page, or if the region cannot be reserved, 0 otherwise
+ */
+int uthread_stack_arena(size_t nstacks, size_t size, bool guard);
+
+#endif /* _STACK_H */
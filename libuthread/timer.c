@@ -0,0 +1,107 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "private.h"
+
+/*
+ * Pending timers, in a binary min-heap ordered by deadline. Each timer knows
+ * its position in the heap, so that it can be cancelled without searching.
+ */
+static struct uthread_timer **heap;
+static size_t heap_size, heap_capacity;
+
+static void heap_set(size_t i, struct uthread_timer *timer)
+{
+	heap[i] = timer;
+	timer->index = i;
+}
+
+static void heap_up(size_t i)
+{
+	struct uthread_timer *timer = heap[i];
+
+	while (i > 0 && heap[(i - 1) / 2]->deadline > timer->deadline) {
+		heap_set(i, heap[(i - 1) / 2]);
+		i = (i - 1) / 2;
+	}
+	heap_set(i, timer);
+}
+
+static void heap_down(size_t i)
+{
+	struct uthread_timer *timer = heap[i];
+	size_t child;
+
+	while ((child = 2 * i + 1) < heap_size) {
+		if (child + 1 < heap_size &&
+		    heap[child + 1]->deadline < heap[child]->deadline)
+			child++;
+		if (heap[child]->deadline >= timer->deadline)
+			break;
+		heap_set(i, heap[child]);
+		i = child;
+	}
+	heap_set(i, timer);
+}
+
+int uthread_timer_add(struct uthread_timer *timer)
+{
+	if (heap_size == heap_capacity) {
+		size_t capacity = heap_capacity ? 2 * heap_capacity : 16;
+		struct uthread_timer **grown =
+			realloc(heap, capacity * sizeof(*heap));
+
+		if (!grown)
+			return -1;
+		heap = grown;
+		heap_capacity = capacity;
+	}
+
+	heap_set(heap_size++, timer);
+	heap_up(timer->index);
+	return 0;
+}
+
+void uthread_timer_cancel(struct uthread_timer *timer)
+{
+	size_t i = timer->index;
+	struct uthread_timer *last;
+
+	if (--heap_size == i)
+		return;
+
+	/* Move the last timer in the hole, then restore the heap order */
+	last = heap[heap_size];
+	heap_set(i, last);
+	heap_up(i);
+	if (last->index == i)
+		heap_down(i);
+}
+
+void uthread_timer_expire(void)
+{
+	uint64_t now;
+
+	if (heap_size == 0)
+		return;
+
+	now = uthread_monotonic_ns();
+	while (heap_size > 0 && heap[0]->deadline <= now) {
+		struct uthread_timer *timer = heap[0];
+
+		uthread_timer_cancel(timer);
+		timer->func(timer);
+	}
+}
+
+int64_t uthread_timer_timeout(void)
+{
+	uint64_t now;
+
+	if (heap_size == 0)
+		return -1;
+
+	now = uthread_monotonic_ns();
+	return heap[0]->deadline > now ? (int64_t)(heap[0]->deadline - now) : 0;
+}
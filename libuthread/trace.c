@@ -0,0 +1,182 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "private.h"
+#include "trace.h"
+
+#ifdef UTHREAD_TRACE
+
+/* Compact binary representation of a recorded event */
+struct trace_event {
+	uint64_t ts;	/* Timestamp from uthread_clock() */
+	uint64_t arg;	/* Argument specific to the type of event */
+	uint32_t tid;	/* Identifier of the thread the event is about */
+	uint32_t type;	/* Type of event */
+};
+
+bool uthread_trace_enabled;
+
+/* Ring buffer, its capacity minus one, and the number of recorded events */
+static struct trace_event *ring;
+static size_t ring_mask;
+static size_t ring_head;
+
+static const char *trace_names[] = {
+	[TRACE_CREATE] = "create",
+	[TRACE_SWITCH] = "switch",
+	[TRACE_YIELD] = "yield",
+	[TRACE_PREEMPT] = "preempt",
+	[TRACE_BLOCK] = "block",
+	[TRACE_UNBLOCK] = "unblock",
+	[TRACE_EXIT] = "exit",
+	[TRACE_SEM_DOWN] = "sem_down",
+	[TRACE_SEM_UP] = "sem_up",
+};
+
+void uthread_trace_record(enum uthread_trace_type type,
+			  struct uthread_tcb *uthread, uintptr_t arg)
+{
+	/*
+	 * Reserve the slot with a single atomic increment, so that the timer
+	 * handler can record an event in the middle of another one
+	 */
+	size_t idx = __atomic_fetch_add(&ring_head, 1, __ATOMIC_RELAXED);
+	struct trace_event *ev = &ring[idx & ring_mask];
+
+	ev->ts = uthread_clock();
+	ev->arg = arg;
+	ev->tid = uthread_id(uthread);
+	ev->type = type;
+}
+
+int uthread_trace_start(size_t nevents)
+{
+	size_t size = 1;
+
+	if (nevents == 0)
+		return -1;
+
+	while (size < nevents)
+		size <<= 1;
+
+	uthread_trace_release();
+	ring = calloc(size, sizeof(*ring));
+	if (!ring)
+		return -1;
+
+	uthread_clock_init();
+	ring_mask = size - 1;
+	ring_head = 0;
+	uthread_trace_enabled = true;
+	return 0;
+}
+
+void uthread_trace_stop(void)
+{
+	uthread_trace_enabled = false;
+}
+
+void uthread_trace_release(void)
+{
+	uthread_trace_enabled = false;
+	free(ring);
+	ring = NULL;
+}
+
+/* Microseconds elapsed between @base and @ts, as expected by trace viewers */
+static double trace_us(uint64_t base, uint64_t ts)
+{
+	return uthread_clock_ns(ts - base) / 1000.0;
+}
+
+int uthread_trace_dump(FILE *f)
+{
+	size_t first, i;
+	uint64_t base, since = 0;
+	uint32_t running = 0;
+	const char *stop = NULL;
+	bool has_running = false, comma = false;
+
+	if (!f || !ring)
+		return -1;
+
+	preempt_disable();
+
+	/* Oldest event still held in the ring buffer */
+	first = ring_head > ring_mask ? ring_head - ring_mask - 1 : 0;
+	base = ring_head > first ? ring[first & ring_mask].ts : 0;
+
+	fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+	for (i = first; i < ring_head; i++) {
+		struct trace_event *ev = &ring[i & ring_mask];
+
+		switch (ev->type) {
+		case TRACE_SWITCH:
+			/*
+			 * Close the slice of the previously running thread, named
+			 * after the reason it stopped running
+			 */
+			if (has_running) {
+				fprintf(f, "%s{\"name\":\"run\",\"ph\":\"X\","
+					"\"pid\":1,\"tid\":%u,\"ts\":%.3f,"
+					"\"dur\":%.3f,\"args\":{\"stop\":\"%s\"}}",
+					comma ? "," : "", running,
+					trace_us(base, since),
+					trace_us(since, ev->ts),
+					stop ? stop : "unknown");
+				comma = true;
+			}
+			has_running = true;
+			running = ev->tid;
+			since = ev->ts;
+			stop = NULL;
+			break;
+		case TRACE_YIELD:
+		case TRACE_PREEMPT:
+		case TRACE_BLOCK:
+		case TRACE_EXIT:
+			if (has_running && ev->tid == running)
+				stop = trace_names[ev->type];
+			/* fallthrough */
+		default:
+			fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\","
+				"\"pid\":1,\"tid\":%u,\"ts\":%.3f,"
+				"\"args\":{\"arg\":\"0x%llx\"}}",
+				comma ? "," : "", trace_names[ev->type], ev->tid,
+				trace_us(base, ev->ts),
+				(unsigned long long)ev->arg);
+			comma = true;
+			break;
+		}
+	}
+	fprintf(f, "]}\n");
+
+	preempt_enable();
+	return 0;
+}
+
+#else /* !UTHREAD_TRACE */
+
+int uthread_trace_start(size_t nevents)
+{
+	(void)nevents;
+	return -1;
+}
+
+void uthread_trace_stop(void)
+{
+}
+
+int uthread_trace_dump(FILE *f)
+{
+	(void)f;
+	return -1;
+}
+
+void uthread_trace_release(void)
+{
+}
+
+#endif /* UTHREAD_TRACE */
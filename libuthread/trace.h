@@ -0,0 +1,56 @@
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+ * Scheduling event trace
+ *
+ * When the library is compiled with tracing support (the default, unless built
+ * with `make TRACE=0`), scheduling events can be recorded into a fixed-size ring
+ * buffer: thread creation, yields, preemptions, blocking, unblocking, exits,
+ * context switches and semaphore operations. Once the buffer is full, the
+ * oldest events are overwritten.
+ *
+ * While tracing is stopped, recording an event costs a single branch.
+ */
+
+/*
+ * uthread_trace_start - Start recording scheduling events
+ * @nevents: Capacity of the ring buffer, rounded up to a power of two
+ *
+ * Any previously recorded event is discarded.
+ *
+ * Return: -1 if @nevents is 0, in case of memory allocation failure, or if the
+ * library was compiled without tracing support. 0 otherwise.
+ */
+int uthread_trace_start(size_t nevents);
+
+/*
+ * uthread_trace_stop - Stop recording scheduling events
+ *
+ * The recorded events are kept until the next call to uthread_trace_start() or
+ * uthread_trace_release().
+ */
+void uthread_trace_stop(void);
+
+/*
+ * uthread_trace_dump - Export recorded events
+ * @f: Stream to write to
+ *
+ * Write the events currently held in the ring buffer in the Chrome trace-event
+ * JSON format, which can be loaded in chrome://tracing or Perfetto. Each
+ * uthread is shown as its own track, with one slice per scheduling quantum
+ * labelled by the reason it ended.
+ *
+ * Return: -1 if @f is NULL or if no buffer was allocated, 0 otherwise.
+ */
+int uthread_trace_dump(FILE *f);
+
+/*
+ * uthread_trace_release - Stop recording and deallocate the ring buffer
+ */
+void uthread_trace_release(void);
+
+#endif /* _TRACE_H */
@@ -1,152 +1,718 @@
 #include <assert.h>
+#include <limits.h>
 #include <signal.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/time.h>
 
 #include "private.h"
 #include "queue.h"
 #include "uthread.h"
+#include "uthread_sched.h"
 
 /* Enum type for thread states */
 typedef enum {
     THREAD_RUNNING,     // Running State
     THREAD_READY,       // Ready State
-    THREAD_EXITED,      // Exited State
-    THREAD_BLOCKED      // Blocked State
+    THREAD_BLOCKED,     // Blocked State
+    THREAD_EXITED,      // Exited State, final so not accounted for
+    THREAD_NR_STATES    // Number of states
 } thread_state_t;
 
-/* Thread Control BLock (TCB) Data Structure */
+/*
+ * Thread Control BLock (TCB) Data Structure
+ *
+ * Only the fields the scheduler touches at every switch are kept here, so that
+ * they fit in one cache line. The rest lives in the cold part.
+ */
 struct uthread_tcb {
-    ucontext_t context;     // Thread Context
+    uthread_ctx_t context;  // Thread Context (saved stack pointer on x86-64)
     thread_state_t state;   // Thread State
+    bool started;           // Whether the stack and context are set up
+    bool suspended;         // Whether waiting for uthread_switch_to()
+    int16_t priority;       // Scheduling priority
+    uint64_t id;            // Thread identifier
+    uint64_t since;         // Timestamp of the last state change
+    uint64_t state_ticks[THREAD_EXITED];    // Clock ticks spent in each state
+    struct uthread_tcb_cold *cold;          // Rarely used data
+} __attribute__((aligned(64)));
+
+#ifdef UTHREAD_CTX_COMPACT
+_Static_assert(sizeof(struct uthread_tcb) == 64, "TCB hot part exceeds a cache line");
+#endif
+
+/* Cold part of the TCB, only used on creation, exit and for statistics */
+struct uthread_tcb_cold {
     void *stack;            // Pointer to the thread's stack
+    size_t stack_size;      // Size of the thread's stack
+    uthread_func_t func;    // Entry function of the thread
+    void *arg;              // Argument of the entry function
+    bool stack_painted;     // Whether the stack is profiled
+    void *local;            // Per-thread data of library modules
+    int16_t base_priority;  // Priority set by uthread_set_priority()
+    int inherited;          // Priority inherited through locks, INT_MIN if none
+    struct uthread_locks locks;             // Locks held and waited for
+    struct uthread_alloc_arena arena;       // Allocations released on exit
+    struct uthread_tcb *link;   // Next thread in an intrusive wait list
+    struct uthread_thread_stats stats;      // Per-thread counters
+};
+
+/* Allocation unit of a TCB, the cold part starting on the next cache line */
+struct uthread_tcb_block {
+    struct uthread_tcb tcb;
+    struct uthread_tcb_cold cold;
 };
 
 /* Global variables */
 static struct uthread_tcb *current_thread = NULL;   // The currently running thread
-static queue_t ready_queue = NULL;                  // Queue of threads ready to be scheduled
+static const struct uthread_sched_ops *sched;       // Scheduler policy, NULL if not running
+static size_t nr_ready;                             // Number of items held by the policy
 struct uthread_tcb idle_thread;                     // Idle Thread
-static queue_t blocked_queue = NULL;                // Queue of threads that are blocked
+static struct uthread_tcb_cold idle_cold;           // Cold part of the idle thread
+static size_t nr_blocked;                           // Number of threads that are blocked
+static struct uthread_stats stats;                  // Scheduler statistics
+static uint64_t next_id;                            // Identifier of the next thread
+static bool preempted;                              // Yield forced by the timer
+static void *pending_task;                          // Task handed over to the idle thread
+static struct uthread_tcb *zombie;                  // Exited thread yet to be freed
+
+/* Stackless task, run to completion by the idle thread */
+struct uthread_task {
+    uthread_func_t func;    // Function of the task
+    void *arg;              // Argument passed to the function
+};
 
 struct uthread_tcb *uthread_current(void) {
     return current_thread;  // Get the current thread
 }
 
+uint64_t uthread_id(struct uthread_tcb *uthread) {
+    return uthread->id;
+}
+
+/*
+ * Change the state of @uthread, charging the time spent in its previous state
+ */
+static void uthread_set_state(struct uthread_tcb *uthread, thread_state_t state,
+                              uint64_t now) {
+    uthread->state_ticks[uthread->state] += now - uthread->since;
+    uthread->since = now;
+    uthread->state = state;
+}
+
+/*
+ * Hand @uthread (a TCB or a tagged task) over to the scheduler policy and keep
+ * track of the high-water mark of runnable items
+ */
+static int uthread_make_ready(void *uthread, enum uthread_sched_event why) {
+    if (sched->enqueue(uthread, why) == -1) {
+        return -1;
+    }
+    if (++nr_ready > stats.ready_queue_hwm) {
+        stats.ready_queue_hwm = nr_ready;
+    }
+    return 0;
+}
+
+/*
+ * Take the next runnable item from the scheduler policy, NULL if there is none
+ */
+static void *uthread_pick_next(void) {
+    void *next = sched->pick_next();
+
+    if (next) {
+        nr_ready--;
+    }
+    return next;
+}
+
+uint64_t uthread_blocked_since(struct uthread_tcb *uthread) {
+    return uthread->since;
+}
+
+size_t uthread_nr_ready(void) {
+    return nr_ready;
+}
+
+uthread_t uthread_self(void) {
+    return sched ? current_thread : NULL;
+}
+
+/*
+ * Recompute the effective priority of @uthread, the highest of its own and the
+ * one it inherits, and move it in the policy if it is runnable. Return whether
+ * it changed.
+ */
+static bool uthread_update_priority(struct uthread_tcb *uthread) {
+    struct uthread_tcb_cold *cold = uthread->cold;
+    int old = uthread->priority;
+    int prio = cold->inherited > cold->base_priority ? cold->inherited
+                                                     : cold->base_priority;
+
+    if (prio == old) {
+        return false;
+    }
+    uthread->priority = prio;
+    if (uthread != &idle_thread && uthread->state == THREAD_READY &&
+        sched && sched->requeue) {
+        sched->requeue(uthread, old);
+    }
+    return true;
+}
+
+int uthread_set_priority(uthread_t uthread, int priority) {
+    if (!uthread || priority < INT16_MIN || priority > INT16_MAX) {
+        return -1;
+    }
+
+    preempt_disable();
+    uthread->cold->base_priority = priority;
+    if (uthread_update_priority(uthread)) {
+        uthread_lock_priority_changed(uthread);
+    }
+    preempt_enable();
+    return 0;
+}
+
+void uthread_inherit_priority(struct uthread_tcb *uthread, int priority) {
+    uthread->cold->inherited = priority;
+    uthread_update_priority(uthread);
+}
+
+struct uthread_locks *uthread_locks(struct uthread_tcb *uthread) {
+    return &uthread->cold->locks;
+}
+
+int uthread_stats_get(struct uthread_stats *out) {
+    if (!out) {
+        return -1;
+    }
+    *out = stats;
+    return 0;
+}
+
+int uthread_thread_stats_get(struct uthread_thread_stats *out) {
+    if (!out || !sched) {   // current_thread outlives uthread_run()
+        return -1;
+    }
+
+    preempt_disable();
+    uint64_t now = uthread_clock();
+    *out = current_thread->cold->stats;
+    out->run_ns = uthread_clock_ns(current_thread->state_ticks[THREAD_RUNNING]
+                                   + now - current_thread->since);
+    out->ready_ns = uthread_clock_ns(current_thread->state_ticks[THREAD_READY]);
+    out->blocked_ns = uthread_clock_ns(current_thread->state_ticks[THREAD_BLOCKED]);
+	preempt_enable();
+    return 0;
+}
+
+/*
+ * Free the TCB and the stack of the last exited thread. This cannot be done by
+ * the thread itself, since it runs on its stack until it switches away.
+ */
+static void uthread_reap(void) {
+    if (zombie) {
+        uthread_ctx_destroy_stack(zombie->cold->stack, zombie->cold->stack_size);
+        free(zombie);   // Along with its cold part
+        zombie = NULL;
+    }
+}
+
+/*
+ * Allocate the stack of @uthread and initialize its context, which is deferred
+ * until the thread is first dispatched so that threads which are created long
+ * before they run do not hold a stack in the meantime
+ */
+static int uthread_start(struct uthread_tcb *uthread) {
+    struct uthread_tcb_cold *cold = uthread->cold;
+
+    cold->stack_size = uthread_stack_size(cold->func);
+    cold->stack_painted = uthread_stack_profiling();
+    cold->stack = uthread_ctx_alloc_stack(cold->stack_size);
+    if (!cold->stack) {
+        return -1;
+    }
+    if (uthread_ctx_init(&uthread->context, cold->stack, cold->stack_size,
+                         cold->func, cold->arg) == -1) {
+        uthread_ctx_destroy_stack(cold->stack, cold->stack_size);
+        return -1;
+    }
+    uthread->started = true;
+    return 0;
+}
+
+/*
+ * Switch from the current thread to @next, which has been taken off the ready
+ * queue (or is the idle thread)
+ */
+static void uthread_switch(struct uthread_tcb *next, uint64_t now) {
+    struct uthread_tcb *prev = current_thread;
+
+    // A thread cannot be told it failed to start, past uthread_create()
+    if (!next->started && uthread_start(next) == -1) {
+        perror("uthread_start");
+        exit(1);
+    }
+
+    uthread_set_state(next, THREAD_RUNNING, now);
+    if (next == prev) {
+        return;
+    }
+    stats.context_switches++;
+    next->cold->stats.switches++;
+    UTHREAD_TRACE_EVENT(TRACE_SWITCH, next, prev->id);
+    current_thread = next;
+    uthread_ctx_switch(&prev->context, &next->context);
+
+    // Back to @prev, right after the thread which switched to it
+    uthread_reap();
+}
+
+/*
+ * Tasks are queued along with the TCBs in the ready queue, tagged by the lowest
+ * bit of their address
+ */
+static bool uthread_is_task(void *item) {
+    return (uintptr_t)item & 1;
+}
+
+int uthread_get_priority(uthread_t uthread) {
+    if (!uthread || uthread_is_task(uthread)) {
+        return 0;
+    }
+    return uthread->priority;
+}
+
+/*
+ * Run a task to completion on the stack of the idle thread
+ */
+static void uthread_run_task(void *item) {
+    struct uthread_task *task = (void *)((uintptr_t)item & ~(uintptr_t)1);
+
+    stats.tasks_run++;
+    task->func(task->arg);
+    free(task);
+}
+
 void uthread_yield(void) {
+    // The idle thread dispatches from its own loop in uthread_run(), so this is
+    // a no-op for it and for the tasks it runs
+    if (current_thread == &idle_thread) {
+        preempted = false;
+        return;
+    }
+
 	preempt_disable();  // Disable preemption
 
+    // Process the wakeups posted from outside of the runtime, by timers, and
+    // now and then by file descriptors
+    uthread_inject_drain();
+    uthread_timer_expire();
+    uthread_io_check();
+
+    uint64_t now = uthread_clock();
+    bool forced = preempted;
+    preempted = false;
+
     // If current thread is running, enqueue it back to the ready queue
     if (current_thread->state == THREAD_RUNNING) {
-        current_thread->state = THREAD_READY;  // Set the state back to ready before enqueue
-        if (queue_enqueue(ready_queue, current_thread) == -1) {
+        if (forced) {
+            stats.preemptive_yields++;
+            current_thread->cold->stats.preemptive_yields++;
+        } else {
+            UTHREAD_TRACE_EVENT(TRACE_YIELD, current_thread, 0);
+            stats.voluntary_yields++;
+            current_thread->cold->stats.voluntary_yields++;
+        }
+        // Set the state back to ready before enqueue
+        uthread_set_state(current_thread, THREAD_READY, now);
+        if (uthread_make_ready(current_thread, forced ? UTHREAD_SCHED_PREEMPT
+                                                      : UTHREAD_SCHED_YIELD) == -1) {
             // Handle enqueue failure
+            uthread_set_state(current_thread, THREAD_RUNNING, now);
+	preempt_enable();
             return;
         }
     }
 
-    if (queue_length(ready_queue) > 0) {
-        void *next_thread_ptr = NULL;
-        if (queue_dequeue(ready_queue, &next_thread_ptr) == -1) {
-            // Handle dequeue failure
-            return;
-        }
-        struct uthread_tcb *next_thread = (struct uthread_tcb *)next_thread_ptr;
-        next_thread->state = THREAD_RUNNING;
-        uthread_ctx_t *prev_context = &current_thread->context;
-        current_thread = next_thread;
-        uthread_ctx_switch(prev_context, &current_thread->context);
+    // Switch directly to the next thread, or let the idle thread run the task
+    // picked by the policy (or wait for threads to become ready)
+    void *next = uthread_pick_next();
+    if (!next || uthread_is_task(next)) {
+        pending_task = next;
+        next = &idle_thread;
+    }
+    if (forced) {
+        UTHREAD_LATENCY_EVENT(uthread_latency_switch());
     }
+    uthread_switch(next, now);
 	preempt_enable();   // Enable preemption
 }
 
+void uthread_preempt(void) {
+    // Let the policy decide whether the time slice of the thread is over
+    if (current_thread == &idle_thread ||
+        (sched->on_tick && !sched->on_tick(current_thread))) {
+        return;
+    }
+    preempted = true;   // Accounted as preemptive by uthread_yield()
+    uthread_yield();
+}
+
 void uthread_exit(void) {
+    assert(current_thread != &idle_thread);     // Tasks must not exit
+    assert(!current_thread->cold->locks.held);  // Locks must be released first
 	preempt_disable();                          // Disable preemption
-    current_thread->state = THREAD_EXITED;      // Set the current thread's state to exited
+    struct uthread_tcb_cold *cold = current_thread->cold;
+    if (cold->stack_painted) {
+        uthread_stack_record(cold->func, cold->stack, cold->stack_size);
+    }
+    uthread_alloc_release(&cold->arena);
+    stats.threads_exited++;
+    UTHREAD_TRACE_EVENT(TRACE_EXIT, current_thread, 0);
+    uthread_set_state(current_thread, THREAD_EXITED, uthread_clock()); // Set the current thread's state to exited
+    uthread_reap();                             // At most one thread is left to reap
+    zombie = current_thread;                    // Freed once switched away from
     uthread_yield();                            // Yield the CPU to another thread
 	preempt_enable();                           // Enable preemption
 }
 
+/*
+ * Allocate and initialize the TCB of a new thread running @func, in @state.
+ * Must be called with preemption disabled.
+ */
+static struct uthread_tcb *uthread_new(uthread_func_t func, void *arg,
+                                       thread_state_t state) {
+    // Allocate a new TCB and initialize it
+    struct uthread_tcb_block *block = aligned_alloc(_Alignof(struct uthread_tcb_block),
+                                                    sizeof(struct uthread_tcb_block));
+    if (!block) {
+        return NULL;
+    }
+    struct uthread_tcb *new_thread = &block->tcb;
+    struct uthread_tcb_cold *cold = &block->cold;
+    new_thread->cold = cold;
+
+    // The stack is only allocated once the thread is first dispatched
+    cold->func = func;
+    cold->arg = arg;
+    cold->local = NULL;
+    memset(&cold->arena, 0, sizeof(cold->arena));
+    cold->locks.held = NULL;
+    cold->locks.waiting = NULL;
+    cold->locks.nr_waiting = 0;
+    new_thread->started = false;
+    new_thread->suspended = false;
+
+    // Inherited priorities are not passed on to new threads
+    cold->base_priority = current_thread->cold->base_priority;
+    cold->inherited = INT_MIN;
+    new_thread->priority = cold->base_priority;
+
+    new_thread->state = state;
+    new_thread->id = ++next_id;
+    new_thread->since = uthread_clock();
+    memset(new_thread->state_ticks, 0, sizeof(new_thread->state_ticks));
+    memset(&cold->stats, 0, sizeof(cold->stats));
+    cold->stats.id = new_thread->id;
+    return new_thread;
+}
+
 int uthread_create(uthread_func_t func, void *arg) {
+    if (!sched) {
+        return -1;
+    }
+
 	 preempt_disable();     // Disable preemption
 
-    // Allocate a new TCB and initialize it
-    struct uthread_tcb *new_thread = malloc(sizeof(struct uthread_tcb));
+    struct uthread_tcb *new_thread = uthread_new(func, arg, THREAD_READY);
     if (!new_thread) {
+	preempt_enable();
         return -1;
     }
 
-    // Allocate stack for the new thread
-    new_thread->stack = uthread_ctx_alloc_stack();
-    if (!new_thread->stack) {
+    // Enqueue the new thread to the ready queue
+    if (uthread_make_ready(new_thread, UTHREAD_SCHED_NEW) == -1) {
         free(new_thread);
+	preempt_enable();
         return -1;
     }
 
-    // Initialize the new thread
-    if (uthread_ctx_init(&new_thread->context, new_thread->stack, func, arg) == -1) {
-        uthread_ctx_destroy_stack(new_thread->stack);
-        free(new_thread);
+    stats.threads_created++;
+    UTHREAD_TRACE_EVENT(TRACE_CREATE, new_thread, current_thread->id);
+	preempt_enable();   // Enable preemption
+    return 0;
+}
+
+uthread_t uthread_create_suspended(uthread_func_t func, void *arg) {
+    if (!sched) {
+        return NULL;
+    }
+
+    preempt_disable();
+
+    // The thread is kept off the policy, and counts as blocked until resumed
+    struct uthread_tcb *new_thread = uthread_new(func, arg, THREAD_BLOCKED);
+    if (!new_thread) {
+        preempt_enable();
+        return NULL;
+    }
+    new_thread->suspended = true;
+    nr_blocked++;
+    if (nr_blocked > stats.blocked_hwm) {
+        stats.blocked_hwm = nr_blocked;
+    }
+
+    stats.threads_created++;
+    UTHREAD_TRACE_EVENT(TRACE_CREATE, new_thread, current_thread->id);
+    preempt_enable();
+    return new_thread;
+}
+
+int uthread_switch_to(uthread_t uthread) {
+    if (!uthread || current_thread == &idle_thread) {
         return -1;
     }
 
-    // Enqueue the new thread to the ready queue
-    new_thread->state = THREAD_READY;
-    if (queue_enqueue(ready_queue, new_thread) == -1) {
-        uthread_ctx_destroy_stack(new_thread->stack);
-        free(new_thread);
+    preempt_disable();
+    if (!uthread->suspended) {
+        preempt_enable();
         return -1;
     }
 
-	preempt_enable();   // Enable preemption
+    // Trade places with @uthread, without going through the policy: the
+    // number of blocked threads does not change
+    uint64_t now = uthread_clock();
+    uthread->suspended = false;
+    current_thread->suspended = true;
+    uthread_set_state(current_thread, THREAD_BLOCKED, now);
+    stats.transfers++;
+    UTHREAD_TRACE_EVENT(TRACE_BLOCK, current_thread, uthread->id);
+    uthread_switch(uthread, now);
+    preempt_enable();
+    return 0;
+}
+
+int uthread_resume(uthread_t uthread) {
+    if (!uthread) {
+        return -1;
+    }
+
+    preempt_disable();
+    if (!uthread->suspended) {
+        preempt_enable();
+        return -1;
+    }
+    uthread->suspended = false;
+    uthread_unblock(uthread);
+    preempt_enable();
     return 0;
 }
 
+int uthread_spawn_task(uthread_func_t func, void *arg) {
+    if (!func || !sched) {
+        return -1;
+    }
+
+    struct uthread_task *task = malloc(sizeof(struct uthread_task));
+    if (!task) {
+        return -1;
+    }
+    task->func = func;
+    task->arg = arg;
+
+	preempt_disable();
+    if (uthread_make_ready((void *)((uintptr_t)task | 1), UTHREAD_SCHED_NEW) == -1) {
+	preempt_enable();
+        free(task);
+        return -1;
+    }
+	preempt_enable();
+    return 0;
+}
+
+/*
+ * Release the scheduler policy at the end of a run
+ */
+static void uthread_sched_release(void) {
+    if (sched->fini) {
+        sched->fini();
+    }
+    sched = NULL;
+}
+
 int uthread_run(bool preempt, uthread_func_t func, void *arg) {
+    return uthread_run_policy(preempt, NULL, func, arg);
+}
+
+int uthread_run_policy(bool preempt, const struct uthread_sched_ops *ops,
+                       uthread_func_t func, void *arg) {
+    // Set up the scheduler policy
+    if (!ops) {
+        ops = &uthread_sched_rr;
+    }
+    if (!ops->enqueue || !ops->pick_next || (ops->init && ops->init() == -1)) {
+        return -1;
+    }
+    sched = ops;
+    if (uthread_inject_init() == -1) {
+        uthread_sched_release();
+        return -1;
+    }
+
 	if(preempt) {
 		preempt_start(preempt);     // Start preemption if enabled
 	}
 
-    // Create the ready and blocked queues
-    ready_queue = queue_create();
-    blocked_queue = queue_create();  // Initialize the blocked queue
-    if (!ready_queue || !blocked_queue) {
-        return -1;
-    }
+    nr_ready = 0;
+    nr_blocked = 0;
+    pending_task = NULL;
+
+    // Reset the statistics of any previous run
+    uthread_clock_init();
+    memset(&stats, 0, sizeof(stats));
+    next_id = 0;
 
     // Set the idle thread as the current thread
     current_thread = &idle_thread;
+    idle_thread.cold = &idle_cold;
+    idle_thread.started = true;
+    idle_thread.priority = 0;
+    idle_cold.base_priority = 0;
+    idle_cold.inherited = INT_MIN;
+    idle_thread.state = THREAD_RUNNING;
+    idle_thread.since = uthread_clock();
 
     // Create the initial thread
     if (uthread_create(func, arg) == -1) {
+        preempt_stop();
+        uthread_sched_release();
         return -1;
     }
 
-    // Run until all threads have finished
-    while (queue_length(ready_queue) > 0 || queue_length(blocked_queue) > 0) {
-        if (queue_length(ready_queue) > 0) {
-            uthread_yield();    // Yield control to the next thread
+    // Dispatch threads and tasks until all threads have finished. Tasks may
+    // re-enable preemption, which is harmless since uthread_yield() is a no-op
+    // for the idle thread, so it is only disabled again before switching away.
+    bool masked = false;
+    while (1) {
+        void *next = NULL;
+
+        uthread_inject_drain();
+        uthread_timer_expire();
+        uthread_io_poll();
+        if (pending_task) {
+            next = pending_task;    // Task a thread found at the head of the ready queue
+            pending_task = NULL;
+        } else if (!(next = uthread_pick_next())) {
+            if (nr_blocked == 0) {
+                break;
+            }
+            // Sleep until a thread gets woken up from outside, by a timer, or
+            // by a file descriptor
+            uthread_inject_wait(uthread_timer_timeout());
+            continue;
+        }
+
+        if (uthread_is_task(next)) {
+            uthread_run_task(next);
+            masked = false;
+            continue;
+        }
+
+        if (!masked) {
+	preempt_disable();
+            masked = true;
         }
+        uint64_t now = uthread_clock();
+        uthread_set_state(&idle_thread, THREAD_READY, now);
+        uthread_switch(next, now);
     }
+    uthread_reap();
+    uthread_alloc_release(&idle_cold.arena);    // Allocations of the tasks
+	preempt_enable();
 
 	preempt_stop();     // Stop preemption
+    uthread_sched_release();
     return 0;
 }
 
+struct uthread_alloc_arena *uthread_current_arena(void) {
+    return sched ? &current_thread->cold->arena : NULL;
+}
+
+void **uthread_local(void) {
+    return &current_thread->cold->local;
+}
+
+struct uthread_tcb **uthread_link(struct uthread_tcb *uthread) {
+    return &uthread->cold->link;
+}
+
 void uthread_block(void) {
+    assert(current_thread != &idle_thread);                     // Tasks must not block
 	preempt_disable();                                          // Disable preemption
-    current_thread->state = THREAD_BLOCKED;                     // Mark the current thread as blocked
-    queue_enqueue(blocked_queue, current_thread);   // Move the current thread to the blocked queue
+    uthread_set_state(current_thread, THREAD_BLOCKED, uthread_clock()); // Mark the current thread as blocked
+    nr_blocked++;                                               // Count the current thread as blocked
+    stats.blocks++;
+    UTHREAD_TRACE_EVENT(TRACE_BLOCK, current_thread, 0);
+    current_thread->cold->stats.blocks++;
+    if (nr_blocked > stats.blocked_hwm) {
+        stats.blocked_hwm = nr_blocked;
+    }
+    if (sched->on_block) {
+        sched->on_block(current_thread);
+    }
     uthread_yield();                                            // Yield control to the next thread
 	preempt_enable();                                           // Enable preemption
 }
 
 void uthread_unblock(struct uthread_tcb *uthread) {
-	preempt_disable();                                          // Disable preemption
-    uthread->state = THREAD_READY;                              // Mark the thread as ready
-    queue_delete(blocked_queue, uthread);           // Remove the thread from the blocked queue
-    queue_enqueue(ready_queue, uthread);            // Move the thread to the ready queue
-	preempt_enable();                                          // Enable preemption
-}
\ No newline at end of file
+    uthread_set_state(uthread, THREAD_READY, uthread_clock());  // Mark the thread as ready
+    nr_blocked--;                                   // The thread is no longer blocked
+    if (sched->on_wake) {
+        sched->on_wake(uthread);
+    }
+    uthread_make_ready(uthread, UTHREAD_SCHED_WAKE);    // Hand the thread to the policy
+    stats.unblocks++;
+    UTHREAD_TRACE_EVENT(TRACE_UNBLOCK, uthread, current_thread->id);
+    uthread->cold->stats.unblocks++;
+}
+/*
+ * Mark a thread about to be moved to the ready queue by uthread_unblock_all()
+ */
+static void uthread_wake(queue_t queue, void *data) {
+    struct uthread_tcb *uthread = data;
+    (void)queue;
+
+    uthread_set_state(uthread, THREAD_READY, uthread_clock());
+    nr_blocked--;
+    stats.unblocks++;
+    UTHREAD_TRACE_EVENT(TRACE_UNBLOCK, uthread, current_thread->id);
+    uthread->cold->stats.unblocks++;
+    if (sched->on_wake) {
+        sched->on_wake(uthread);
+    }
+}
+
+void uthread_unblock_all(queue_t waiters) {
+    struct uthread_tcb *uthread;
+
+    if (!sched->enqueue_queue) {
+        while (queue_dequeue(waiters, (void **)&uthread) == 0) {
+            uthread_unblock(uthread);
+        }
+        return;
+    }
+
+    size_t n = queue_length(waiters);
+    queue_iterate(waiters, uthread_wake);           // Mark all the threads as ready
+    sched->enqueue_queue(waiters);                  // Hand them to the policy at once
+    nr_ready += n;
+    if (nr_ready > stats.ready_queue_hwm) {
+        stats.ready_queue_hwm = nr_ready;
+    }
+}
@@ -2,6 +2,8 @@
 #define _UTHREAD_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 /*
  * uthread_func_t - Thread function type
@@ -9,6 +11,13 @@
  */
 typedef void (*uthread_func_t)(void *arg);
 
+/*
+ * uthread_t - Thread handle
+ *
+ * A handle stays valid until the thread it refers to exits.
+ */
+typedef struct uthread_tcb *uthread_t;
+
 /*
  * uthread_run - Run the multithreading library
  * @preempt: Preemption enable
@@ -34,11 +43,35 @@ int uthread_run(bool preempt, uthread_func_t func, void *arg);
  * This function creates a new thread running the function @func to which
  * argument @arg is passed.
  *
- * Return: 0 in case of success, -1 in case of failure (e.g., memory allocation,
- * context creation).
+ * The stack of the thread is only allocated, and its context initialized, when
+ * the thread is first scheduled, so that threads waiting for their turn only
+ * cost their TCB. The process exits with an error message if the stack cannot
+ * be allocated at that point.
+ *
+ * Return: 0 in case of success, -1 in case of failure (e.g., memory allocation).
  */
 int uthread_create(uthread_func_t func, void *arg);
 
+/*
+ * uthread_spawn_task - Spawn a stackless task
+ * @func: Function to be executed by the task
+ * @arg: Argument to be passed to the task
+ *
+ * This function queues @func to be run to completion directly on the stack of
+ * the scheduler, in FIFO order with the threads of the ready queue. A task costs
+ * a small allocation instead of a TCB and a stack, and running it involves no
+ * context switch when the scheduler finds several tasks in a row.
+ *
+ * Tasks are never preempted, and must neither block nor exit: they must not
+ * call sem_down() on a semaphore which is not available, nor uthread_exit().
+ * uthread_yield() returns immediately when called from a task. Tasks can create
+ * threads, spawn other tasks and release semaphores.
+ *
+ * Return: 0 in case of success, -1 in case of failure (e.g., memory allocation,
+ * called outside of uthread_run()).
+ */
+int uthread_spawn_task(uthread_func_t func, void *arg);
+
 /*
  * uthread_yield - Yield execution
  *
@@ -57,4 +90,141 @@ void uthread_yield(void);
  */
 void uthread_exit(void);
 
+/*
+ * uthread_self - Get handle of currently running thread
+ *
+ * Return: Handle of the calling thread, or NULL if called outside of
+ * uthread_run()
+ */
+uthread_t uthread_self(void);
+
+/*
+ * uthread_set_priority - Set the priority of a thread
+ * @uthread: Thread whose priority to set
+ * @priority: New priority, between -32768 and 32767
+ *
+ * Priorities are only used by scheduler policies which support them (see
+ * uthread_sched.h), and by default higher values are more urgent. New threads
+ * inherit the priority of the thread which creates them, 0 for the first
+ * thread. A thread which is already runnable is moved according to its new
+ * priority right away if the policy supports it, or else the next time it is
+ * handed to the policy.
+ *
+ * While threads of higher priority wait on a lock it holds (see
+ * sem_create_lock()), a thread runs with the highest of their priorities.
+ *
+ * Return: -1 if @uthread is NULL or if @priority is out of range, 0 otherwise
+ */
+int uthread_set_priority(uthread_t uthread, int priority);
+
+/*
+ * uthread_get_priority - Get the priority of a thread
+ * @uthread: Thread, or runnable item handed to a scheduler policy
+ *
+ * Return: Priority of @uthread, including any priority it inherits through the
+ * locks it holds, 0 for stackless tasks
+ */
+int uthread_get_priority(uthread_t uthread);
+
+/*
+ * uthread_create_suspended - Create a new thread in suspended state
+ * @func: Function to be executed by the thread
+ * @arg: Argument to be passed to the thread
+ *
+ * Same as uthread_create(), but the thread is not handed to the scheduler: it
+ * only starts running when another thread transfers the CPU to it with
+ * uthread_switch_to(), or when it is resumed with uthread_resume(). A suspended
+ * thread counts as blocked, so uthread_run() does not return while some thread
+ * is left suspended.
+ *
+ * Return: Handle of the new thread, or NULL in case of failure (e.g., memory
+ * allocation, called outside of uthread_run()).
+ */
+uthread_t uthread_create_suspended(uthread_func_t func, void *arg);
+
+/*
+ * uthread_switch_to - Transfer the CPU directly to a suspended thread
+ * @uthread: Suspended thread to run
+ *
+ * The calling thread is suspended and @uthread runs right away, without either
+ * of them going through the scheduler policy. Two threads handing control back
+ * and forth with this function thus run as symmetric coroutines, whatever the
+ * number of other runnable threads. The calling thread returns from this
+ * function once another thread transfers the CPU back to it, or resumes it.
+ *
+ * Return: 0 once the calling thread runs again, -1 if @uthread is NULL or not
+ * suspended, or if called from a stackless task.
+ */
+int uthread_switch_to(uthread_t uthread);
+
+/*
+ * uthread_resume - Hand a suspended thread back to the scheduler
+ * @uthread: Suspended thread
+ *
+ * @uthread becomes runnable as if woken up, and the calling thread keeps
+ * running. This is how a thread which is done transferring the CPU with
+ * uthread_switch_to() lets its partner carry on, e.g. before exiting.
+ *
+ * Return: 0 in case of success, -1 if @uthread is NULL or not suspended
+ */
+int uthread_resume(uthread_t uthread);
+
+/*
+ * uthread_stats - Scheduler statistics
+ *
+ * Counters are accumulated over the lifetime of the last call to uthread_run().
+ * The idle thread is not accounted for in the yield counters.
+ */
+struct uthread_stats {
+	uint64_t context_switches;	/* Number of context switches */
+	uint64_t voluntary_yields;	/* Yields requested by threads */
+	uint64_t preemptive_yields;	/* Yields forced by the preemption timer */
+	uint64_t blocks;		/* Number of times a thread blocked */
+	uint64_t unblocks;		/* Number of times a thread was unblocked */
+	uint64_t threads_created;	/* Number of threads created */
+	uint64_t threads_exited;	/* Number of threads which exited */
+	size_t ready_queue_hwm;		/* Largest number of runnable items */
+	size_t blocked_hwm;		/* Largest number of blocked threads */
+	uint64_t tasks_run;		/* Number of tasks run to completion */
+	uint64_t transfers;		/* Number of uthread_switch_to() transfers */
+};
+
+/*
+ * uthread_thread_stats - Per-thread accounting
+ *
+ * Times are expressed in nanoseconds, and include the current state up to the
+ * moment the statistics are retrieved.
+ */
+struct uthread_thread_stats {
+	uint64_t id;			/* Thread identifier, 0 is the idle thread */
+	uint64_t switches;		/* Number of times the thread was scheduled */
+	uint64_t voluntary_yields;	/* Yields requested by the thread */
+	uint64_t preemptive_yields;	/* Yields forced by the preemption timer */
+	uint64_t blocks;		/* Number of times the thread blocked */
+	uint64_t unblocks;		/* Number of times the thread was unblocked */
+	uint64_t run_ns;		/* Time spent running */
+	uint64_t ready_ns;		/* Time spent waiting in the ready queue */
+	uint64_t blocked_ns;		/* Time spent blocked */
+};
+
+/*
+ * uthread_stats_get - Get scheduler statistics
+ * @stats: Structure to fill in
+ *
+ * The counters are maintained at all times with plain increments, so this
+ * function can be used in production builds.
+ *
+ * Return: -1 if @stats is NULL, 0 otherwise
+ */
+int uthread_stats_get(struct uthread_stats *stats);
+
+/*
+ * uthread_thread_stats_get - Get accounting of the currently running thread
+ * @stats: Structure to fill in
+ *
+ * Return: -1 if @stats is NULL or if called outside of uthread_run(), 0
+ * otherwise
+ */
+int uthread_thread_stats_get(struct uthread_thread_stats *stats);
+
 #endif /* _THREAD_H */
@@ -0,0 +1,115 @@
+#ifndef _UTHREAD_SCHED_H
+#define _UTHREAD_SCHED_H
+
+#include <stdbool.h>
+
+#include "queue.h"
+#include "uthread.h"
+
+/*
+ * Scheduler policies
+ *
+ * A policy decides which runnable item runs next. Items are threads, or the
+ * stackless tasks of uthread_spawn_task(), and are opaque to the policy: apart
+ * from storing them, it can only look at their priority with
+ * uthread_get_priority(). The policy keeps the runnable items in its own data
+ * structure, and the library calls its operations with preemption disabled.
+ *
+ * The idle thread is never handed to the policy: it runs when the policy has
+ * nothing to pick, and it runs the tasks picked by the policy.
+ */
+
+/* Reasons for an item to be handed to the policy */
+enum uthread_sched_event {
+	UTHREAD_SCHED_NEW,	/* Thread just created, or task just spawned */
+	UTHREAD_SCHED_YIELD,	/* Thread which called uthread_yield() */
+	UTHREAD_SCHED_PREEMPT,	/* Thread preempted by the timer */
+	UTHREAD_SCHED_WAKE,	/* Thread unblocked */
+};
+
+/*
+ * uthread_sched_ops - Operations of a scheduler policy
+ *
+ * Only @enqueue and @pick_next are mandatory.
+ */
+struct uthread_sched_ops {
+	/* Name of the policy, for reports */
+	const char *name;
+
+	/* Set up the policy when uthread_run_policy() starts, -1 on failure */
+	int (*init)(void);
+
+	/* Release the policy once uthread_run_policy() is done, with no item */
+	void (*fini)(void);
+
+	/* Add a runnable item, return -1 on failure */
+	int (*enqueue)(uthread_t item, enum uthread_sched_event why);
+
+	/* Remove and return the item to run next, NULL if there is none */
+	uthread_t (*pick_next)(void);
+
+	/*
+	 * Add all the woken up threads of queue @items, oldest first, leaving
+	 * @items empty. Return -1 on failure. If not provided, @enqueue is
+	 * called for each thread.
+	 */
+	int (*enqueue_queue)(queue_t items);
+
+	/* Called when a running thread blocks */
+	void (*on_block)(uthread_t uthread);
+
+	/* Called when a blocked thread is woken up, before it is enqueued */
+	void (*on_wake)(uthread_t uthread);
+
+	/*
+	 * Called at every tick of the preemption timer with the running
+	 * thread. Return whether it should be preempted. If not provided, it
+	 * always is.
+	 */
+	bool (*on_tick)(uthread_t uthread);
+
+	/*
+	 * Called when the priority of a thread the policy holds changes, from
+	 * @old_priority to its current one, so that the policy can move it. If
+	 * not provided, the new priority applies from the next @enqueue.
+	 */
+	void (*requeue)(uthread_t uthread, int old_priority);
+};
+
+/*
+ * Policies shipped with the library
+ *
+ * - uthread_sched_rr: round-robin, the default. Items run in FIFO order.
+ * - uthread_sched_runnext: round-robin, except that the most recently created
+ *   or woken up item runs next, ahead of the FIFO. A bounded number of items
+ *   in a row run this way, so that threads waking each other up cannot starve
+ *   the others.
+ * - uthread_sched_lifo: created and woken up items run first, most recent
+ *   first, while yielding and preempted threads go to the back of the line.
+ * - uthread_sched_prio: items of higher priority (0 to UTHREAD_SCHED_PRIO_MAX,
+ *   out of range priorities being clamped) run first, in FIFO order among
+ *   items of the same priority. Lower priorities can starve.
+ */
+extern const struct uthread_sched_ops uthread_sched_rr;
+extern const struct uthread_sched_ops uthread_sched_runnext;
+extern const struct uthread_sched_ops uthread_sched_lifo;
+extern const struct uthread_sched_ops uthread_sched_prio;
+
+#define UTHREAD_SCHED_PRIO_MAX 7
+
+/*
+ * uthread_run_policy - Run the multithreading library with a given policy
+ * @preempt: Preemption enable
+ * @ops: Scheduler policy, NULL for the default round-robin policy
+ * @func: Function of the first thread to start
+ * @arg: Argument to be passed to the first thread
+ *
+ * Same as uthread_run(), with the scheduling decisions made by @ops.
+ *
+ * Return: 0 in case of success, -1 in case of failure (e.g., memory allocation,
+ * policy missing a mandatory operation or failing to initialize).
+ */
+int uthread_run_policy(bool preempt, const struct uthread_sched_ops *ops,
+		       uthread_func_t func, void *arg);
+
+#endif /* _UTHREAD_SCHED_H */